@@ -0,0 +1,71 @@
+/*
+* bench_builtins: measures how many commands per second msh runs for echo, true, printf and sleep 0,
+* launched as programs and run in the shell with set -o builtins. The commands are fed to msh
+* on stdin and their output goes to /dev/null.
+*
+* Build from the bench directory:
+*   gcc -O2 -o bench_builtins bench_builtins.c
+*
+* Usage: bench_builtins [COMMANDS] [MSH]   (defaults: 2000 ../bin/msh)
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static double run_script(const char *msh, const char *command, int count, bool builtins) {
+    // Run count copies of command through msh, returns the elapsed milliseconds or -1 on failure
+    FILE *script = tmpfile();
+    if (builtins) {
+        fprintf(script, "set -o builtins\n");
+    }
+    for (int i = 0; i < count; i++) {
+        fprintf(script, "%s\n", command);
+    }
+    fprintf(script, "exit\n");
+    fflush(script);
+    rewind(script);
+    double start = now_ms();
+    pid_t pid = fork();
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(fileno(script), STDIN_FILENO);
+        dup2(null, STDOUT_FILENO);
+        dup2(null, STDERR_FILENO);
+        execl(msh, msh, (char *)NULL);
+        _exit(127);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    double elapsed = now_ms() - start;
+    fclose(script);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? elapsed : -1;
+}
+
+int main(int argc, char **argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 2000;
+    const char *msh = argc > 2 ? argv[2] : "../bin/msh";
+    const char *commands[] = {"true", "echo hello", "printf %s-%d a 1", "sleep 0"};
+    for (size_t c = 0; c < sizeof(commands) / sizeof(commands[0]); c++) {
+        for (int builtins = 0; builtins <= 1; builtins++) {
+            double ms = run_script(msh, commands[c], count, builtins);
+            if (ms < 0) {
+                fprintf(stderr, "bench_builtins: %s failed\n", msh);
+                return 1;
+            }
+            printf("{\"bench\":\"%s\",\"command\":\"%s\",\"builtins\":%s,\"commands\":%d,\"ms\":%.1f,\"commands_per_s\":%.0f}\n",
+                builtins ? "fast_builtin" : "program", commands[c], builtins ? "true" : "false", count, ms, count / (ms / 1000));
+        }
+    }
+    return 0;
+}
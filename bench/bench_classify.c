@@ -0,0 +1,102 @@
+/*
+* bench_classify: measures lexing long command lines character by character (count_args and
+* lex_command) against the bitmask index built by each classifier (index_line, count_args_indexed
+* and lex_command_indexed).
+*
+* Build from the bench directory:
+*   gcc -O2 -I../include -o bench_classify bench_classify.c $(ls ../src/*.c | grep -v msh.c)
+*
+* Usage: bench_classify [BYTES]
+*/
+#include "shell.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static int lex_all(char *line, size_t len, bool indexed, arena_t *arena, char ***vector, int *vector_size) {
+    // Split every command of line, returns the number of arguments found
+    line_index_t *index = indexed ? index_line(arena, line, len) : NULL;
+    int max_args = indexed ? count_args_indexed(index) : count_args(line);
+    if (max_args + 1 > *vector_size) {
+        *vector_size = max_args + 1;
+        *vector = realloc(*vector, *vector_size * sizeof(char *));
+    }
+    int total = 0;
+    int job_type;
+    char *cursor = line;
+    while (cursor != NULL) {
+        total += indexed ? lex_command_indexed(index, &cursor, *vector, &job_type) : lex_command(&cursor, *vector, &job_type);
+    }
+    return total;
+}
+
+int main(int argc, char *argv[]) {
+    size_t bytes = argc > 1 ? (size_t)atol(argv[1]) : 256 * 1024;
+    // Build a line of short and long arguments, with a command separator every 100 arguments
+    char *line = malloc(bytes + 64);
+    char *copy = malloc(bytes + 64);
+    size_t len = 0;
+    for (int i = 0; len < bytes; i++) {
+        len += sprintf(line + len, i % 100 == 99 ? "x%d ; " : (i % 7 == 0 ? "--option-%d=value\t" : "a%d "), i);
+    }
+    arena_t *arena = alloc_arena();
+    char **vector = NULL;
+    int vector_size = 0;
+    const int rounds = 200;
+
+    double start = now_ms();
+    int expected = 0;
+    for (int r = 0; r < rounds; r++) {
+        memcpy(copy, line, len + 1);
+        expected = lex_all(copy, len, false, arena, &vector, &vector_size);
+    }
+    double scalar_us = (now_ms() - start) * 1000.0 / rounds;
+    printf("{\"bench\":\"lex_bytewise\",\"bytes\":%zu,\"args\":%d,\"us_per_line\":%.3f,\"mb_per_s\":%.1f}\n",
+        len, expected, scalar_us, len / scalar_us);
+
+    const char *backends[] = {"scalar", "sse2", "avx2"};
+    size_t words = (len + 63) / 64;
+    uint64_t *spaces = malloc(words * sizeof(uint64_t));
+    uint64_t *separators = malloc(words * sizeof(uint64_t));
+    for (int b = 0; b < 3; b++) {
+        if (!classify_set_backend(backends[b])) {
+            continue;
+        }
+        start = now_ms();
+        for (int r = 0; r < rounds; r++) {
+            classify_line(line, len, spaces, separators);
+        }
+        double classify_us = (now_ms() - start) * 1000.0 / rounds;
+        int got = 0;
+        start = now_ms();
+        for (int r = 0; r < rounds; r++) {
+            memcpy(copy, line, len + 1);
+            arena_mark_t mark = arena_mark(arena);
+            got = lex_all(copy, len, true, arena, &vector, &vector_size);
+            arena_release(arena, mark);
+        }
+        double indexed_us = (now_ms() - start) * 1000.0 / rounds;
+        if (got != expected) {
+            fprintf(stderr, "bench_classify: %s found %d arguments instead of %d\n", backends[b], got, expected);
+            return 1;
+        }
+        printf("{\"bench\":\"classify_%s\",\"bytes\":%zu,\"us_per_line\":%.3f,\"mb_per_s\":%.1f}\n",
+            backends[b], len, classify_us, len / classify_us);
+        printf("{\"bench\":\"lex_indexed_%s\",\"bytes\":%zu,\"args\":%d,\"us_per_line\":%.3f,\"mb_per_s\":%.1f}\n",
+            backends[b], len, got, indexed_us, len / indexed_us);
+    }
+    free(spaces);
+    free(separators);
+    free(vector);
+    free_arena(arena);
+    free(copy);
+    free(line);
+    return 0;
+}
@@ -0,0 +1,64 @@
+/*
+* bench_history: measures add_line_history and find_line_history once the history holds many
+* lines, with the lines appended to the history file in batches.
+*
+* Build from the bench directory:
+*   gcc -O2 -I../include -o bench_history bench_history.c ../src/history.c ../src/history_index.c ../src/arena.c
+*
+* Usage: bench_history [MAX_HISTORY]
+*/
+#include "history.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+    int max_history = argc > 1 ? atoi(argv[1]) : 1000000;
+    HISTORY_FILE_PATH = "/tmp/msh_bench_history";
+    remove(HISTORY_FILE_PATH);
+    history_t *history = alloc_history(max_history);
+    set_history_commit(history, 4096, 0);
+    char line[128];
+
+    // Fill the history, then keep adding so the oldest lines are dropped
+    double start = now_ms();
+    for (int i = 0; i < max_history; i++) {
+        snprintf(line, sizeof(line), "/usr/bin/gcc -O%d -c src/module_%d.c -o build/module_%d.o", i % 4, i, i);
+        add_line_history(history, line);
+    }
+    double fill_ns = (now_ms() - start) * 1e6 / max_history;
+    start = now_ms();
+    for (int i = 0; i < max_history; i++) {
+        snprintf(line, sizeof(line), "make -j%d test_%d", i % 16, i);
+        add_line_history(history, line);
+    }
+    double full_ns = (now_ms() - start) * 1e6 / max_history;
+
+    // Recall lines all over the history, as !N does
+    const int rounds = 1000000;
+    size_t bytes = 0;
+    start = now_ms();
+    for (int i = 0; i < rounds; i++) {
+        char *found = find_line_history(history, 1 + (int)((i * 7919L) % max_history));
+        bytes += found != NULL ? found[0] != '\0' : 0;
+    }
+    double find_ns = (now_ms() - start) * 1e6 / rounds;
+    if (bytes != rounds) {
+        fprintf(stderr, "bench_history: %zu of %d lookups found a line\n", bytes, rounds);
+        return 1;
+    }
+
+    printf("{\"bench\":\"history_add\",\"max_history\":%d,\"ns_per_op\":%.1f}\n", max_history, fill_ns);
+    printf("{\"bench\":\"history_add_full\",\"max_history\":%d,\"ns_per_op\":%.1f}\n", max_history, full_ns);
+    printf("{\"bench\":\"history_find\",\"max_history\":%d,\"ns_per_op\":%.1f}\n", max_history, find_ns);
+    free_history(history);
+    remove(HISTORY_FILE_PATH);
+    return 0;
+}
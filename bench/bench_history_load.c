@@ -0,0 +1,74 @@
+/*
+* bench_history_load: measures how long alloc_history takes before the first prompt
+* can be shown, against the getline + strndup loader it replaced.
+*
+* Build from the bench directory:
+*   gcc -O2 -I../include -o bench_history_load bench_history_load.c ../src/history.c ../src/history_index.c ../src/arena.c
+*
+* Usage: bench_history_load [LINES]
+*/
+#include "history.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void write_history_file(const char *path, int lines) {
+    FILE *fp = fopen(path, "w");
+    for (int i = 0; i < lines; i++) {
+        fprintf(fp, "/usr/bin/gcc -O2 -Wall -c src/file_%d.c -o build/file_%d.o\n", i, i);
+    }
+    fclose(fp);
+}
+
+static double getline_load(const char *path, int max_history) {
+    // The loader alloc_history used before the file was mapped: one strndup per line
+    double start = now_ms();
+    char **lines = malloc(max_history * sizeof(char *));
+    int next = 0;
+    FILE *fp = fopen(path, "r");
+    char *line = NULL;
+    size_t len = 0;
+    long nread;
+    while ((nread = getline(&line, &len, fp)) != -1 && next < max_history) {
+        lines[next++] = strndup(line, strcspn(line, "\n"));
+    }
+    free(line);
+    fclose(fp);
+    double elapsed = now_ms() - start;
+    for (int i = 0; i < next; i++) {
+        free(lines[i]);
+    }
+    free(lines);
+    return elapsed;
+}
+
+int main(int argc, char *argv[]) {
+    int lines = argc > 1 ? atoi(argv[1]) : 200000;
+    const char *path = "/tmp/msh_bench_history";
+    write_history_file(path, lines);
+    HISTORY_FILE_PATH = path;
+
+    double old_ms = getline_load(path, lines);
+
+    double start = now_ms();
+    history_t *history = alloc_history(lines);
+    double mmap_ms = now_ms() - start;
+    // The first use of a line copies it out of the mapped file
+    start = now_ms();
+    find_line_history(history, lines / 2);
+    double first_use_ms = now_ms() - start;
+    free_history(history);
+
+    printf("{\"bench\":\"history_load\",\"impl\":\"getline\",\"lines\":%d,\"ms\":%.3f}\n", lines, old_ms);
+    printf("{\"bench\":\"history_load\",\"impl\":\"mmap\",\"lines\":%d,\"ms\":%.3f}\n", lines, mmap_ms);
+    printf("{\"bench\":\"history_first_use\",\"impl\":\"mmap\",\"lines\":%d,\"ms\":%.3f}\n", lines, first_use_ms);
+    remove(path);
+    return 0;
+}
@@ -0,0 +1,56 @@
+/*
+* bench_history_search: measures !prefix and !?pattern? lookups on a large history.
+*
+* Build from the bench directory:
+*   gcc -O2 -I../include -o bench_history_search bench_history_search.c ../src/history.c ../src/history_index.c ../src/arena.c
+*
+* Usage: bench_history_search [LINES]
+*/
+#include "history.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+    int lines = argc > 1 ? atoi(argv[1]) : 300000;
+    HISTORY_FILE_PATH = "/tmp/msh_bench_history";
+    remove(HISTORY_FILE_PATH);
+    history_t *history = alloc_history(lines);
+    set_history_commit(history, 4096, 0);
+    char line[128];
+    for (int i = 0; i < lines; i++) {
+        snprintf(line, sizeof(line), "/usr/bin/gcc -O%d -c src/module_%d.c -o build/module_%d.o", i % 4, i, i);
+        add_line_history(history, line);
+    }
+    // The first search builds the index
+    double start = now_ms();
+    search_history_prefix(history, "/usr/bin/gcc");
+    double build_ms = now_ms() - start;
+
+    const int rounds = 1000;
+    start = now_ms();
+    for (int i = 0; i < rounds; i++) {
+        search_history_prefix(history, "/usr/bin/gcc -O2");
+    }
+    double prefix_us = (now_ms() - start) * 1000.0 / rounds;
+    start = now_ms();
+    for (int i = 0; i < rounds; i++) {
+        snprintf(line, sizeof(line), "module_%d.c", (i * 7919) % lines);
+        search_history_substring(history, line);
+    }
+    double substring_us = (now_ms() - start) * 1000.0 / rounds;
+
+    printf("{\"bench\":\"history_index_build\",\"lines\":%d,\"ms\":%.3f}\n", lines, build_ms);
+    printf("{\"bench\":\"history_search_prefix\",\"lines\":%d,\"us_per_op\":%.3f}\n", lines, prefix_us);
+    printf("{\"bench\":\"history_search_substring\",\"lines\":%d,\"us_per_op\":%.3f}\n", lines, substring_us);
+    free_history(history);
+    remove(HISTORY_FILE_PATH);
+    return 0;
+}
@@ -0,0 +1,69 @@
+/*
+* bench_jobs: measures the job table operations the shell runs for every job (add_job, find_job,
+* change_job_state and delete_job) when the table holds many jobs.
+*
+* Build from the bench directory:
+*   gcc -O2 -I../include -o bench_jobs bench_jobs.c ../src/job.c ../src/arena.c
+*
+* Usage: bench_jobs [MAX_JOBS]
+*/
+#include "job.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+    int max_jobs = argc > 1 ? atoi(argv[1]) : 100000;
+    job_t *jobs = alloc_jobs(max_jobs);
+    // Pids of running jobs are spread out, not consecutive
+    pid_t *pids = malloc(max_jobs * sizeof(pid_t));
+    for (int i = 0; i < max_jobs; i++) {
+        pids[i] = 1000 + (pid_t)((i * 7919L) % 4000000);
+    }
+
+    double start = now_ms();
+    for (int i = 0; i < max_jobs; i++) {
+        add_job(jobs, max_jobs, pids[i], BACKGROUND, "/bin/sleep 10");
+    }
+    double add_ns = (now_ms() - start) * 1e6 / max_jobs;
+
+    const int rounds = 1000000;
+    int found = 0;
+    start = now_ms();
+    for (int i = 0; i < rounds; i++) {
+        found += find_job(jobs, max_jobs, pids[(i * 31L) % max_jobs]) != NULL;
+    }
+    double find_ns = (now_ms() - start) * 1e6 / rounds;
+
+    start = now_ms();
+    for (int i = 0; i < rounds; i++) {
+        change_job_state(jobs, max_jobs, pids[(i * 31L) % max_jobs], i % 2 ? SUSPENDED : BACKGROUND);
+    }
+    double change_ns = (now_ms() - start) * 1e6 / rounds;
+
+    // Jobs end in a different order than they started
+    start = now_ms();
+    for (int i = 0; i < max_jobs; i++) {
+        delete_job(jobs, max_jobs, pids[(i * 31L) % max_jobs]);
+    }
+    double delete_ns = (now_ms() - start) * 1e6 / max_jobs;
+    if (found != rounds || !add_job(jobs, max_jobs, 1, FOREGROUND, "ls") || get_job_jid(jobs, max_jobs, 1) == -1) {
+        fprintf(stderr, "bench_jobs: the job table lost jobs\n");
+        return 1;
+    }
+
+    printf("{\"bench\":\"jobs_add\",\"max_jobs\":%d,\"ns_per_op\":%.1f}\n", max_jobs, add_ns);
+    printf("{\"bench\":\"jobs_find\",\"max_jobs\":%d,\"ns_per_op\":%.1f}\n", max_jobs, find_ns);
+    printf("{\"bench\":\"jobs_change_state\",\"max_jobs\":%d,\"ns_per_op\":%.1f}\n", max_jobs, change_ns);
+    printf("{\"bench\":\"jobs_delete\",\"max_jobs\":%d,\"ns_per_op\":%.1f}\n", max_jobs, delete_ns);
+    free(pids);
+    free_jobs(jobs, max_jobs);
+    return 0;
+}
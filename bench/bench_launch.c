@@ -0,0 +1,81 @@
+/*
+* bench_launch: measures how many external commands per second msh launches with each launcher
+* backend, started directly (-X spawn, -X fork) and through the zygote (-Z), as foreground jobs
+* and as background jobs the shell waits for at the end. The shell history is filled first so the
+* shell is not trivially small when it forks.
+*
+* Build from the bench directory:
+*   gcc -O2 -o bench_launch bench_launch.c
+*
+* Usage: bench_launch [COMMANDS] [MSH]   (defaults: 2000 ../bin/msh)
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static double run_script(const char *msh, char *const *options, int count, bool background) {
+    // Run count copies of /bin/true through msh with the given options, returns the elapsed milliseconds or -1 on failure
+    FILE *script = tmpfile();
+    for (int i = 0; i < count; i++) {
+        fprintf(script, background ? "/bin/true &\n" : "/bin/true\n");
+    }
+    fprintf(script, background ? "wait\nexit\n" : "exit\n");
+    fflush(script);
+    rewind(script);
+    char *argv[8] = {(char *)msh, "-s", "100000"};
+    int argc = 3;
+    for (int i = 0; options[i] != NULL; i++) {
+        argv[argc++] = options[i];
+    }
+    argv[argc] = NULL;
+    double start = now_ms();
+    pid_t pid = fork();
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(fileno(script), STDIN_FILENO);
+        dup2(null, STDOUT_FILENO);
+        dup2(null, STDERR_FILENO);
+        execv(msh, argv);
+        _exit(127);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    double elapsed = now_ms() - start;
+    fclose(script);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? elapsed : -1;
+}
+
+int main(int argc, char **argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 2000;
+    const char *msh = argc > 2 ? argv[2] : "../bin/msh";
+    const char *names[] = {"spawn", "fork", "zygote_spawn", "zygote_fork"};
+    char *const options[][4] = {
+        {"-X", "spawn", NULL},
+        {"-X", "fork", NULL},
+        {"-Z", "-X", "spawn", NULL},
+        {"-Z", "-X", "fork", NULL},
+    };
+    for (int background = 0; background <= 1; background++) {
+        for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+            double ms = run_script(msh, options[i], count, background);
+            if (ms < 0) {
+                fprintf(stderr, "bench_launch: %s failed\n", msh);
+                return 1;
+            }
+            printf("{\"bench\":\"launch_%s\",\"jobs\":\"%s\",\"commands\":%d,\"ms\":%.1f,\"commands_per_s\":%.0f,\"us_per_command\":%.1f}\n",
+                names[i], background ? "background" : "foreground", count, ms, count / (ms / 1000), ms * 1000 / count);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,63 @@
+/*
+* bench_parse: measures parse_tok and separate_args on short command lines like the ones typed at the
+* prompt, the path every line goes through before anything is launched.
+*
+* Build from the bench directory:
+*   gcc -O2 -I../include -o bench_parse bench_parse.c $(ls ../src/*.c | grep -v msh.c)
+*
+* Usage: bench_parse [ROUNDS]
+*/
+#include "shell.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 1000000;
+    const char *line = "ls -l /tmp & sleep 10 & grep -rn pattern src include ; echo done";
+    char *copy = malloc(strlen(line) + 1);
+    int commands = 0;
+    int args = 0;
+
+    // Split the line into its jobs, the copy is modified in place
+    double start = now_ms();
+    for (int i = 0; i < rounds; i++) {
+        strcpy(copy, line);
+        int job_type;
+        char *saveptr;
+        for (char *command = parse_tok_r(copy, &job_type, &saveptr); command != NULL;
+            command = parse_tok_r(NULL, &job_type, &saveptr)) {
+            commands++;
+        }
+    }
+    double parse_ns = (now_ms() - start) * 1e6 / rounds;
+
+    // Split one command into its arguments
+    const char *command = "grep -rn pattern src include --exclude-dir=.git";
+    start = now_ms();
+    for (int i = 0; i < rounds; i++) {
+        strcpy(copy, command);
+        int count;
+        bool is_builtin;
+        char **command_argv = separate_args(copy, &count, &is_builtin);
+        args += count;
+        free(command_argv);
+    }
+    double separate_ns = (now_ms() - start) * 1e6 / rounds;
+
+    if (commands != 4 * rounds || args != 6 * rounds) {
+        fprintf(stderr, "bench_parse: found %d commands and %d arguments\n", commands, args);
+        return 1;
+    }
+    printf("{\"bench\":\"parse_tok\",\"commands_per_line\":4,\"ns_per_line\":%.1f}\n", parse_ns);
+    printf("{\"bench\":\"separate_args\",\"args\":6,\"ns_per_command\":%.1f}\n", separate_ns);
+    free(copy);
+    return 0;
+}
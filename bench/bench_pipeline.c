@@ -0,0 +1,69 @@
+/*
+* bench_pipeline: measures the throughput of a pipeline run by msh, with the stages sharing a pipe
+* and with the shell relaying the bytes between them (set -o relay). The last stage writes to /dev/null.
+*
+* Build from the bench directory:
+*   gcc -O2 -o bench_pipeline bench_pipeline.c
+*
+* Usage: bench_pipeline [MEGABYTES] [MSH]   (defaults: 1024 ../bin/msh)
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static double run_pipeline(const char *msh, long megabytes, bool relay, int stages) {
+    // Run one pipeline of stages through msh, returns the elapsed milliseconds or -1 on failure
+    FILE *script = tmpfile();
+    if (relay) {
+        fprintf(script, "set -o relay\n");
+    }
+    fprintf(script, "head -c %ldM /dev/zero", megabytes);
+    for (int i = 1; i < stages; i++) {
+        fprintf(script, " | cat");
+    }
+    fprintf(script, "\nexit\n");
+    fflush(script);
+    rewind(script);
+    double start = now_ms();
+    pid_t pid = fork();
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(fileno(script), STDIN_FILENO);
+        dup2(null, STDOUT_FILENO);
+        dup2(null, STDERR_FILENO);
+        execl(msh, msh, (char *)NULL);
+        _exit(127);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    double elapsed = now_ms() - start;
+    fclose(script);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? elapsed : -1;
+}
+
+int main(int argc, char **argv) {
+    long megabytes = argc > 1 ? atol(argv[1]) : 1024;
+    const char *msh = argc > 2 ? argv[2] : "../bin/msh";
+    for (int stages = 2; stages <= 4; stages += 2) {
+        for (int relay = 0; relay <= 1; relay++) {
+            double ms = run_pipeline(msh, megabytes, relay, stages);
+            if (ms < 0) {
+                fprintf(stderr, "bench_pipeline: %s failed\n", msh);
+                return 1;
+            }
+            printf("{\"bench\":\"pipeline_%s\",\"stages\":%d,\"megabytes\":%ld,\"ms\":%.1f,\"mb_per_s\":%.0f}\n",
+                relay ? "relay" : "direct", stages, megabytes, ms, megabytes / (ms / 1000));
+        }
+    }
+    return 0;
+}
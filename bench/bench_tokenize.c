@@ -0,0 +1,90 @@
+/*
+* bench_tokenize: measures splitting 10k-argument command lines with the strtok + realloc
+* tokenizer the shell used to have, separate_args and lex_command.
+*
+* Build from the bench directory:
+*   gcc -O2 -I../include -o bench_tokenize bench_tokenize.c $(ls ../src/*.c | grep -v msh.c)
+*
+* Usage: bench_tokenize [ARGS]
+*/
+#include "shell.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static char **strtok_args(char *line, int *argc) {
+    // The previous tokenizer: one realloc per argument
+    char **argv = NULL;
+    *argc = 0;
+    char *token = strtok(line, " ");
+    while (token != NULL) {
+        (*argc)++;
+        argv = realloc(argv, ((*argc) + 1) * sizeof(char *));
+        argv[(*argc) - 1] = token;
+        token = strtok(NULL, " ");
+    }
+    if (argv != NULL) {
+        argv[*argc] = NULL;
+    }
+    return argv;
+}
+
+int main(int argc, char *argv[]) {
+    int args = argc > 1 ? atoi(argv[1]) : 10000;
+    // Build a line of args arguments of varying length
+    size_t size = (size_t)args * 16 + 16;
+    char *line = malloc(size);
+    char *copy = malloc(size);
+    size_t len = 0;
+    len += sprintf(line + len, "echo");
+    for (int i = 1; i < args; i++) {
+        len += sprintf(line + len, " arg%d", i * 7919 % 100000);
+    }
+    const int rounds = 200;
+    int got = 0;
+
+    double start = now_ms();
+    for (int r = 0; r < rounds; r++) {
+        memcpy(copy, line, len + 1);
+        char **tokens = strtok_args(copy, &got);
+        free(tokens);
+    }
+    double strtok_us = (now_ms() - start) * 1000.0 / rounds;
+
+    start = now_ms();
+    for (int r = 0; r < rounds; r++) {
+        memcpy(copy, line, len + 1);
+        char **tokens = separate_args(copy, &got, NULL);
+        free(tokens);
+    }
+    double separate_us = (now_ms() - start) * 1000.0 / rounds;
+
+    char **vector = malloc((args + 1) * sizeof(char *));
+    start = now_ms();
+    for (int r = 0; r < rounds; r++) {
+        memcpy(copy, line, len + 1);
+        char *cursor = copy;
+        int job_type;
+        got = lex_command(&cursor, vector, &job_type);
+    }
+    double lex_us = (now_ms() - start) * 1000.0 / rounds;
+    if (got != args) {
+        fprintf(stderr, "bench_tokenize: expected %d arguments, got %d\n", args, got);
+        return 1;
+    }
+
+    printf("{\"bench\":\"tokenize_strtok_realloc\",\"args\":%d,\"us_per_line\":%.3f}\n", args, strtok_us);
+    printf("{\"bench\":\"tokenize_separate_args\",\"args\":%d,\"us_per_line\":%.3f}\n", args, separate_us);
+    printf("{\"bench\":\"tokenize_lex_command\",\"args\":%d,\"us_per_line\":%.3f}\n", args, lex_us);
+    free(vector);
+    free(copy);
+    free(line);
+    return 0;
+}
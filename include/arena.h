@@ -0,0 +1,91 @@
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <stddef.h>
+
+// Represents a block of memory allocations are bumped out of, chained after the previous block
+typedef struct arena_chunk {
+    struct arena_chunk *next;   // The next chunk, kept when the arena is released so it can be reused
+    size_t size;                // The number of bytes available in data
+    char data[];
+}arena_chunk_t;
+
+// Represents a bump allocator for data that does not outlive a command line
+typedef struct arena {
+    arena_chunk_t *first;       // The first chunk, NULL until the first allocation
+    arena_chunk_t *current;     // The chunk allocations are bumped out of
+    size_t used;                // The number of bytes used in current
+}arena_t;
+
+// Represents a position in an arena, everything allocated after it is released at once
+typedef struct arena_mark {
+    arena_chunk_t *chunk;
+    size_t used;
+}arena_mark_t;
+
+// Counts allocations so the hot path can be checked for malloc calls (i.e. the memstats builtin)
+typedef struct alloc_stats {
+    unsigned long arena_allocs;     // The number of allocations served by arenas
+    unsigned long arena_bytes;      // The number of bytes allocated from arenas
+    unsigned long arena_chunks;     // The number of chunks arenas allocated with malloc
+    unsigned long arena_releases;   // The number of times an arena was released to a mark
+    unsigned long pool_mallocs;     // The number of mallocs by the pools of data outliving a line (job commands, history)
+}alloc_stats_t;
+
+extern alloc_stats_t alloc_stats;
+
+/*
+* alloc_arena: allocates an empty arena, chunks are allocated on the first allocations
+*
+* Returns: an arena_t pointer that is allocated and initialized
+*/
+arena_t *alloc_arena(void);
+
+/*
+* arena_alloc: allocate memory from an arena, aligned for any type
+*
+* arena: the arena
+*
+* size: the number of bytes to allocate
+*
+* Returns: the memory, valid until the arena is released to a mark taken before this call
+*/
+void *arena_alloc(arena_t *arena, size_t size);
+
+/*
+* arena_strdup: copy a string into an arena
+*
+* arena: the arena
+*
+* str: the string to copy
+*
+* Returns: the copy, valid until the arena is released to a mark taken before this call
+*/
+char *arena_strdup(arena_t *arena, const char *str);
+
+/*
+* arena_mark: get the current position of an arena
+*
+* arena: the arena
+*
+* Returns: the position, to be passed to arena_release
+*/
+arena_mark_t arena_mark(arena_t *arena);
+
+/*
+* arena_release: free everything allocated from an arena since a mark was taken, the chunks are kept for reuse
+*
+* arena: the arena
+*
+* mark: a position returned by arena_mark
+*/
+void arena_release(arena_t *arena, arena_mark_t mark);
+
+/*
+* free_arena: free an arena and all its chunks
+*
+* arena: the arena
+*/
+void free_arena(arena_t *arena);
+
+#endif
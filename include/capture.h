@@ -0,0 +1,88 @@
+#ifndef _CAPTURE_H_
+#define _CAPTURE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// The most output kept for a captured job, a power of two. Older output is dropped.
+#define CAPTURE_LIMIT (64 * 1024)
+// The ring of a job starts this small and doubles while the job writes more
+#define CAPTURE_MIN_SIZE 4096
+
+// Represents the stdout and stderr of a background job, read by the shell into a ring that keeps the latest output
+typedef struct capture {
+    int fd;             // The read end of the pipe the job writes to, -1 once it reached end of file
+    int jid;            // The job number the lines are tagged with when they are written out
+    char *buf;          // The ring, NULL until the job wrote something
+    size_t size;        // The number of bytes allocated for buf, a power of two up to CAPTURE_LIMIT
+    uint64_t head;      // The number of bytes read so far, the next byte goes to buf[head % size]
+    uint64_t tail;      // The first byte still in the ring, head - tail bytes are kept
+    uint64_t dropped;   // The number of bytes dropped because the ring was full, since the last replay
+    bool live;          // Set while the job is in the foreground, its output is written as it arrives
+    bool line_start;    // The next byte written out starts a line, so it gets the [jid] tag
+}capture_t;
+
+/*
+* start_capture: create the pipe a job writes its output to and read it from the event loop
+*
+* write_fd: set to the write end of the pipe, to be passed to the job as its stdout and stderr and closed afterwards
+*
+* Returns: the capture, to be ended with end_capture. NULL if the pipe cannot be created.
+*/
+capture_t *start_capture(int *write_fd);
+
+/*
+* capture_read: read what the job wrote since the last call without blocking, called by the event loop
+*
+* capture: the capture
+*/
+void capture_read(capture_t *capture);
+
+/*
+* capture_view: find the captured output in the ring without copying it
+*
+* capture: the capture
+*
+* first, first_len: set to the older part of the output
+*
+* second, second_len: set to the part that wrapped around to the start of the ring, second_len is 0 if it did not wrap
+*/
+void capture_view(const capture_t *capture, const char **first, size_t *first_len, const char **second, size_t *second_len);
+
+/*
+* print_capture: write the captured output as it is, straight from the ring with one writev
+*
+* capture: the capture
+*
+* fd: the file descriptor to write to, stdout is flushed first
+*/
+void print_capture(const capture_t *capture, int fd);
+
+/*
+* replay_capture: write the captured output line by line, each line tagged with [jid], and empty the ring
+*
+* capture: the capture
+*
+* out: the stream to write to
+*/
+void replay_capture(capture_t *capture, FILE *out);
+
+/*
+* capture_foreground: replay the output captured so far and write further output as it arrives (i.e. for fg),
+* or go back to keeping it in the ring
+*
+* capture: the capture
+*
+* live: true when the job is brought to the foreground, false when it leaves it
+*/
+void capture_foreground(capture_t *capture, bool live);
+
+/*
+* end_capture: read the rest of the output, replay it to stdout and free the capture, once the job is done
+*
+* capture: the capture
+*/
+void end_capture(capture_t *capture);
+
+#endif
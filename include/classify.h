@@ -0,0 +1,46 @@
+#ifndef _CLASSIFY_H_
+#define _CLASSIFY_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Represents a command line classified into bitmasks, bit i of a mask describes line[i]
+typedef struct line_index {
+    char *line;             // The command line the index was built for
+    size_t len;             // The length of the command line
+    uint64_t *spaces;       // Bits set for whitespace characters
+    uint64_t *separators;   // Bits set for the job separators '&' and ';'
+}line_index_t;
+
+/*
+* classify_line: find every whitespace and job separator character of a line in one pass,
+* using the fastest classifier the processor supports (AVX2, SSE2 or scalar)
+*
+* line: the characters to classify
+*
+* len: the number of characters to classify
+*
+* spaces: filled with (len + 63) / 64 words, bit i is set if line[i] is whitespace
+*
+* separators: filled with (len + 63) / 64 words, bit i is set if line[i] is '&' or ';'
+*/
+void classify_line(const char *line, size_t len, uint64_t *spaces, uint64_t *separators);
+
+/*
+* classify_backend: get the name of the classifier used by classify_line
+*
+* Returns: "avx2", "sse2" or "scalar"
+*/
+const char *classify_backend(void);
+
+/*
+* classify_set_backend: force the classifier used by classify_line (i.e. to compare them in benchmarks)
+*
+* name: "avx2", "sse2" or "scalar"
+*
+* Returns: false if the processor does not support the classifier, which is then left unchanged
+*/
+bool classify_set_backend(const char *name);
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef _EVENT_LOOP_H_
+#define _EVENT_LOOP_H_
+
+#include <stdbool.h>
+
+// Called when a registered file descriptor is readable (or always, for regular files), or writable for writers
+typedef void event_handler_t(int fd, void *data);
+
+// Called when a timer expires
+typedef void timer_handler_t(void *data);
+
+/*
+* event_loop_init: creates the epoll instance and the timerfd that drive the event loop of the shell
+*/
+void event_loop_init(void);
+
+/*
+* event_loop_add_fd: call handler whenever fd becomes readable
+*
+* fd: the file descriptor to watch. Regular files cannot be polled, they are treated as always readable.
+*
+* handler: the function called with fd and data
+*
+* data: passed to handler unchanged
+*/
+void event_loop_add_fd(int fd, event_handler_t *handler, void *data);
+
+/*
+* event_loop_add_writer: call handler whenever fd becomes writable, i.e. a full pipe was drained
+*
+* fd: the file descriptor to watch, it must not be watched for reading at the same time
+*
+* handler: the function called with fd and data
+*
+* data: passed to handler unchanged
+*/
+void event_loop_add_writer(int fd, event_handler_t *handler, void *data);
+
+/*
+* event_loop_remove_fd: stop watching a file descriptor, does nothing if it is not watched
+*
+* fd: the file descriptor
+*/
+void event_loop_remove_fd(int fd);
+
+/*
+* event_loop_pause_fd: temporarily stop (or resume) dispatching a watched file descriptor,
+* i.e. stdin while a foreground job owns it
+*
+* fd: the file descriptor, nothing happens if it is not watched
+*
+* paused: true to stop dispatching fd, false to resume
+*/
+void event_loop_pause_fd(int fd, bool paused);
+
+/*
+* event_loop_add_timer: call handler once after a delay
+*
+* delay_ms: the number of milliseconds to wait
+*
+* handler: the function called with data
+*
+* data: passed to handler unchanged
+*
+* Returns: the id of the timer, to be used with event_loop_cancel_timer
+*/
+int event_loop_add_timer(long delay_ms, timer_handler_t *handler, void *data);
+
+/*
+* event_loop_cancel_timer: cancel a timer that has not expired yet
+*
+* id: the id returned by event_loop_add_timer, ids of expired timers may have been reused
+*/
+void event_loop_cancel_timer(int id);
+
+/*
+* event_loop_run_once: wait for events and dispatch every ready handler once
+*
+* timeout_ms: the maximum number of milliseconds to wait, -1 to wait until an event arrives
+*/
+void event_loop_run_once(int timeout_ms);
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef _FAST_BUILTINS_H_
+#define _FAST_BUILTINS_H_
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+// Pseudo jobs get pids from here on, the kernel never hands out pids this large (PID_MAX_LIMIT)
+#define PSEUDO_PID_BASE 4194304
+
+/*
+* run_fast_builtin: run echo, true, false or printf in the shell process instead of launching the program,
+* the command may be given by name or as /bin/NAME or /usr/bin/NAME
+*
+* argv: the arguments of the command
+*
+* Returns: true if the command was run, false if it is not one of these utilities or if it is printf with
+* a width or precision given as * (the program is launched instead)
+*/
+bool run_fast_builtin(char **argv);
+
+/*
+* parse_interval: parse a time interval the way sleep and timeout do, a number followed by an optional unit (s, m, h or d)
+*
+* arg: the interval, i.e. 1.5 or 2m
+*
+* Returns: the interval in seconds, -1 if arg is not a valid interval
+*/
+double parse_interval(const char *arg);
+
+/*
+* sleep_duration: check whether a command is sleep, and get how long it sleeps
+*
+* argv: the arguments of the command, sleep accepts the same NUMBER[smhd]... intervals as the program
+*
+* ms: set to the number of milliseconds to sleep, or -1 if an interval is invalid (the error is printed)
+*
+* Returns: true if the command is sleep, false otherwise
+*/
+bool sleep_duration(char **argv, long *ms);
+
+/*
+* start_pseudo_job: start a sleep that runs on an event loop timer instead of in a process
+*
+* ms: the number of milliseconds to sleep
+*
+* Returns: the pid of the pseudo job, to be added to the jobs array by the caller. The job is deleted
+* with job_exited when the timer expires.
+*/
+pid_t start_pseudo_job(long ms);
+
+/*
+* is_pseudo_job: check whether a pid belongs to a pseudo job, safe to call from signal handlers
+*
+* pid: the pid to check
+*
+* Returns: true if pid was returned by start_pseudo_job
+*/
+bool is_pseudo_job(pid_t pid);
+
+/*
+* signal_pseudo_job: act on a signal sent to a pseudo job, SIGSTOP and SIGTSTP suspend the timer,
+* SIGCONT resumes it, and any other signal terminates the job
+*
+* pid: the pid of the pseudo job
+*
+* sig: the signal
+*
+* Returns: false if there is no such pseudo job
+*/
+bool signal_pseudo_job(pid_t pid, int sig);
+
+#endif
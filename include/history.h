@@ -4,14 +4,37 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "history_index.h"
 
 extern const char *HISTORY_FILE_PATH;
 
 //Represents the state of the history of the shell
+//The lines are kept in a ring of offsets into one contiguous arena of '\0' terminated strings.
+//Lines loaded from HISTORY_FILE_PATH stay in the mapped file until they are first used.
 typedef struct history {
-    char **lines;
+    char *arena;            // Storage of the lines, compacted when it fills up
+    size_t arena_size;      // The number of bytes allocated for the arena
+    size_t arena_used;      // The offset in the arena where the next line is copied to
+    size_t live_bytes;      // The number of arena bytes used by lines still in the history
+    size_t *offsets;        // Ring of arena offsets, one per line in the history, or of map offsets for lines not used yet
+    int first;              // The position in offsets of the oldest line
     int max_history;
-    int next;
+    int next;               // The number of lines in the history
+    const char *map;        // The history file as it was when the shell started, NULL once no line refers to it
+    size_t map_size;
+    int mapped_lines;       // The number of lines in the history still read from map
+    const char *file_path;  // The history file new lines are appended to
+    int fd;                 // The history file opened with O_APPEND, -1 if it cannot be written
+    int file_lines;         // The number of lines in the history file
+    char *pending;          // Lines added to the history but not yet written to the file
+    size_t pending_len;
+    size_t pending_size;
+    int pending_lines;
+    int commit_lines;       // Write the pending lines once this many are waiting (group commit)
+    int fsync_commits;      // fsync the history file after this many writes, 0 to never fsync
+    int commits;            // The number of writes since the last fsync
+    unsigned int added;     // The number of lines ever added, the newest line has this sequence number
+    history_index_t *index; // The search index, built by the first search and kept up to date afterwards
 }history_t;
 
 /*
@@ -24,7 +47,7 @@ typedef struct history {
 history_t *alloc_history(int max_history);
 
 /*
-* add_line_history: add a new line to the history
+* add_line_history: add a new line to the history and append it to HISTORY_FILE_PATH
 *
 * history: the history state
 *
@@ -51,8 +74,57 @@ void print_history(history_t *history);
 char *find_line_history(history_t *history, int index);
 
 /*
-* free_history: save all history inside char ** lines array in 
-HISTORY_FILE_PATH and free the history state and all allocated memory
+* search_history_prefix: find the most recent line starting with a prefix (i.e. !prefix)
+*
+* history: the history state
+*
+* prefix: the prefix to search for
+*
+* Returns: the index of the line as used by find_line_history, 0 if no line starts with prefix
+*/
+int search_history_prefix(history_t *history, const char *prefix);
+
+/*
+* search_history_substring: find the most recent line containing a pattern (i.e. !?pattern?)
+*
+* history: the history state
+*
+* pattern: the pattern to search for
+*
+* Returns: the index of the line as used by find_line_history, 0 if no line contains pattern
+*/
+int search_history_substring(history_t *history, const char *pattern);
+
+/*
+* print_history_matches: print the lines containing a pattern with their index (i.e. history -s pattern)
+*
+* history: the history state
+*
+* pattern: the pattern to search for
+*/
+void print_history_matches(history_t *history, const char *pattern);
+
+/*
+* set_history_commit: configure how lines are batched when appended to HISTORY_FILE_PATH
+*
+* history: the history state
+*
+* commit_lines: the number of lines written together in one write, 1 writes every line as it is added
+*
+* fsync_commits: the number of writes after which the file is synced to disk, 0 never syncs
+*/
+void set_history_commit(history_t *history, int commit_lines, int fsync_commits);
+
+/*
+* flush_history: write the lines still waiting for their group commit to HISTORY_FILE_PATH
+*
+* history: the history state
+*/
+void flush_history(history_t *history);
+
+/*
+* free_history: write the pending lines to HISTORY_FILE_PATH, which is rewritten to hold only
+the lines in the history if it grew past max_history, and free the history state and all allocated memory
 * 
 * history: the history state
 */
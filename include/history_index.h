@@ -0,0 +1,92 @@
+#ifndef _HISTORY_INDEX_H_
+#define _HISTORY_INDEX_H_
+
+#include <stddef.h>
+
+// The number of leading characters of each line kept in the prefix trie
+#define HISTORY_TRIE_DEPTH 32
+
+// Represents the sequence numbers of the lines containing one trigram, oldest first
+typedef struct posting_list {
+    unsigned int trigram;   // The three bytes of the trigram, 0 marks an empty bucket
+    unsigned int *seqs;
+    int len;
+    int size;
+}posting_list_t;
+
+// Represents a node of the prefix trie, its children are linked through sibling
+typedef struct trie_node {
+    unsigned char c;        // The character leading to this node from its parent
+    int child;              // The first child of this node, -1 if it has none
+    int sibling;            // The next child of the same parent, -1 if it is the last one
+    unsigned int max_seq;   // The most recent line whose prefix ends at this node
+}trie_node_t;
+
+// Represents the search index over the history lines, identified by increasing sequence numbers
+typedef struct history_index {
+    posting_list_t *postings;   // Open addressing hash table of trigram posting lists
+    int num_postings;
+    int postings_size;          // Always a power of two
+    trie_node_t *nodes;         // nodes[0] is the root of the prefix trie
+    int num_nodes;
+    int nodes_size;
+    int lines_indexed;          // The number of lines added since the index was allocated
+}history_index_t;
+
+/*
+* alloc_history_index: allocates and initializes an empty history index
+*
+* Returns: a history_index_t pointer that is allocated and initialized
+*/
+history_index_t *alloc_history_index(void);
+
+/*
+* history_index_add: index a line, lines must be added in increasing sequence number order
+*
+* index: the history index
+*
+* seq: the sequence number of the line, greater than 0
+*
+* line: the text of the line, not necessarily '\0' terminated
+*
+* len: the length of the line
+*/
+void history_index_add(history_index_t *index, unsigned int seq, const char *line, size_t len);
+
+/*
+* history_index_prefix: find the most recent line starting with a prefix
+*
+* index: the history index
+*
+* prefix: the prefix, at most HISTORY_TRIE_DEPTH characters
+*
+* len: the length of the prefix
+*
+* Returns: the sequence number of the most recent line with the prefix, 0 if no line has it
+*/
+unsigned int history_index_prefix(history_index_t *index, const char *prefix, size_t len);
+
+/*
+* history_index_candidates: find the lines that may contain a pattern
+*
+* index: the history index
+*
+* pattern: the pattern searched for
+*
+* len: the length of the pattern
+*
+* seqs: stores the sequence numbers of the candidate lines, oldest first, at the memory location of the seqs pointer
+*
+* Returns: the number of candidates, or -1 if the pattern is shorter than a trigram and every line is a candidate.
+* Each candidate contains every trigram of the pattern at least once, so it still has to be checked.
+*/
+int history_index_candidates(history_index_t *index, const char *pattern, size_t len, const unsigned int **seqs);
+
+/*
+* free_history_index: free the history index and all allocated memory
+*
+* index: the history index
+*/
+void free_history_index(history_index_t *index);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef _INPUT_H_
+#define _INPUT_H_
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+// Represents the input of the shell, read from a file descriptor in large chunks and handed out one line at a time
+typedef struct input {
+    int fd;             // The file descriptor the input is read from
+    char *buf;          // The bytes read but not consumed yet, from start to len
+    size_t start;       // The first byte of buf that was not handed out as a line
+    size_t len;         // The number of bytes used in buf
+    size_t size;        // The number of bytes allocated for buf
+    bool eof;           // Set once a read reached the end of the file
+}input_t;
+
+/*
+* alloc_input: allocates and initializes an empty input
+*
+* fd: the file descriptor to read from
+*
+* Returns: an input_t pointer that is allocated and initialized
+*/
+input_t *alloc_input(int fd);
+
+/*
+* input_read: read once from the file descriptor into the buffer, which invalidates the lines returned so far
+*
+* input: the input
+*
+* Returns: the number of bytes read, 0 at the end of the file (eof is set), -1 on error (errno is set)
+*/
+ssize_t input_read(input_t *input);
+
+/*
+* input_next_line: take the next complete line out of the buffer
+*
+* input: the input
+*
+* Returns: the line without its newline character, or NULL if the buffer does not hold a complete line.
+* Once eof is set, a last line without a newline character is returned as well.
+* The line stays valid until the next call to input_read.
+*/
+char *input_next_line(input_t *input);
+
+/*
+* free_input: free all the memory allocated for the input, the file descriptor is not closed
+*
+* input: the input
+*/
+void free_input(input_t *input);
+
+#endif
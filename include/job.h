@@ -6,17 +6,100 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "capture.h"
 
 typedef enum job_state{FOREGROUND, BACKGROUND, SUSPENDED, UNDEFINED} job_state_t;
 
+// Represents one process of a pipeline job
+typedef struct job_stage {
+    pid_t pid;          // The process id of the stage
+    int pidfd;          // The pidfd the shell tracks the stage with, -1 if there is none
+    bool done;          // Set once the stage terminated
+}job_stage_t;
+
+// Represents the resources used by the processes of a job, summed over the stages reaped so far
+typedef struct job_usage {
+    struct timespec started;    // When the job was launched, on the monotonic clock
+    double wall_ms;             // The time from launch until the last process was reaped, 0 while the job runs
+    double user_ms;             // The CPU time spent in user mode
+    double sys_ms;              // The CPU time spent in the kernel
+    long max_rss_kb;            // The largest maximum resident set size of any of the processes
+    long voluntary_switches;    // Context switches because a process waited (i.e. for I/O)
+    long involuntary_switches;  // Context switches because a process was preempted
+}job_usage_t;
+
 // Represents a job in a shell.
 typedef struct job {
     char *cmd_line;     // The command line for this specific job.
     job_state_t state;  // The current state for this job
-    pid_t pid;          // The process id for this job
+    pid_t pid;          // The process id for this job, the process group ID of a pipeline
     int jid;            // The job number for this job
+    int pidfd;          // The pidfd the shell tracks this job with, -1 if there is none (or the job is a pipeline)
+    job_stage_t *stages;    // The processes of a pipeline, stages[0] is the process group leader. NULL for a single command
+    int num_stages;         // The number of processes of the job
+    int live_stages;        // The number of processes of the job that did not terminate yet
+    bool stopped;           // Set while the stages of a pipeline are stopped, so the job is reported stopped once
+    bool timed;             // Set for jobs run with the time builtin, their usage is printed when they are done
+    job_usage_t usage;      // The resources used by the job, filled in as its processes are reaped
+    capture_t *capture;     // The output of a background job run with &> (or set -o capture), NULL if it writes to the terminal
+    int timeout_timer;      // The event loop timer enforcing the deadline of the job (timeout or set -o timeout), -1 if it has none
+    int timeout_signal;     // The signal last sent because the deadline passed (SIGTERM, then SIGKILL), 0 while it did not pass
 }job_t;
 
+// Bookkeeping kept in front of the jobs array so lookups, inserts and deletes are O(1)
+// while every function keeps taking the jobs array itself
+typedef struct job_table {
+    int max_jobs;       // The number of slots in the jobs array
+    int *free_slots;    // Stack of empty slot indices, the top is reused first
+    int num_free;       // The number of entries in free_slots
+    pid_t *index_pids;  // Open addressing hash index from pid to slot, 0 marks an empty bucket
+    int *index_slots;   // The slot of the job whose pid is stored in the same bucket of index_pids
+    int index_size;     // The number of buckets in the index, always a power of two
+    int index_count;    // The number of pids in the index, jobs and the other stages of pipelines
+    int *next_used;     // Links the occupied slots in the order the jobs were added, -1 ends the list
+    int *prev_used;
+    int first_used;
+    int last_used;
+    char **cmd_bufs;    // The command line buffer of each slot, kept when the job is deleted and reused by the next job
+    size_t *cmd_sizes;  // The number of bytes allocated for each buffer in cmd_bufs
+    job_stage_t **stage_bufs;   // The stages buffer of each slot, kept and reused like cmd_bufs
+    int *stage_sizes;           // The number of stages allocated for each buffer in stage_bufs
+    job_t jobs[];       // The jobs array handed out by alloc_jobs
+}job_table_t;
+
+/*
+* alloc_jobs: allocates and initializes an empty jobs array
+*
+* max_jobs: the maximum number of jobs
+*
+* returns: the jobs array, to be freed with free_jobs
+*/
+job_t *alloc_jobs(int max_jobs);
+
+/*
+* grow_jobs: enlarge the jobs array, every job keeps its slot and job id
+*
+* jobs: the jobs array
+*
+* max_jobs: the new maximum number of jobs, larger than the current one
+*
+* returns: the enlarged jobs array, which replaces jobs (i.e. jobs must not be used afterwards)
+*/
+job_t *grow_jobs(job_t *jobs, int max_jobs);
+
+/*
+* jobs_full: check whether every slot of the jobs array is used
+*
+* jobs: the jobs array
+*
+* max_jobs: the maximum number of jobs
+*
+* returns: true if add_job would fail, false otherwise
+*/
+bool jobs_full(job_t *jobs, int max_jobs);
+
 /*
 * add_job: add a new job to the jobs array
 * 
@@ -62,6 +145,71 @@ bool change_job_state(job_t *jobs, int max_jobs, pid_t pid, job_state_t state);
 */
 bool delete_job(job_t *jobs, int max_jobs, pid_t pid);
 
+/*
+* add_stage: add a process to a pipeline job, every stage can be found by its own pid
+*
+* jobs: the jobs array
+*
+* max_jobs: the maximum number of jobs
+*
+* pid: the process id of the job (i.e. the process group leader, its first stage)
+*
+* stage_pid: the process id of the stage to add
+*
+* returns: true if the stage was added, false if the job was not found
+*/
+bool add_stage(job_t *jobs, int max_jobs, pid_t pid, pid_t stage_pid);
+
+/*
+* find_stage: find the stage of a pipeline job based on its process id
+*
+* job: the job
+*
+* pid: the process id of the stage
+*
+* returns: the stage, or NULL if the job is not a pipeline or has no such stage
+*/
+job_stage_t *find_stage(job_t *job, pid_t pid);
+
+/*
+* end_stage: mark a stage of a pipeline job as terminated, its pid does not find the job anymore
+* unless it is the process group leader
+*
+* jobs: the jobs array
+*
+* max_jobs: the maximum number of jobs
+*
+* pid: the process id of the stage
+*
+* returns: the number of stages of the job still running, 0 if the job is done (or is not a pipeline)
+*/
+int end_stage(job_t *jobs, int max_jobs, pid_t pid);
+
+/*
+* add_usage: add the resources used by a reaped process of a job to the usage of the job
+*
+* job: the job
+*
+* usage: the resource usage returned by wait4 for the process, NULL if it is not known
+*/
+void add_usage(job_t *job, const struct rusage *usage);
+
+/*
+* finish_usage: record the wall clock time of a job whose last process was reaped
+*
+* job: the job
+*/
+void finish_usage(job_t *job);
+
+/*
+* print_usage: print the resources used by a job on one line (i.e. real 1.002s user 0.950s ...)
+*
+* out: the stream to print to
+*
+* usage: the usage of the job. The wall clock time of a running job is measured up to now.
+*/
+void print_usage(FILE *out, const job_usage_t *usage);
+
 /*
 * free_jobs: free all the memory allocated for the jobs array
 * 
@@ -80,6 +228,16 @@ void free_jobs(job_t *jobs, int max_jobs);
 */
 void print_jobs(job_t *jobs, int max_jobs);
 
+/*
+* print_jobs_long: print all the jobs in the jobs array with their resource usage so far,
+* and the pid and state of every stage of a pipeline
+*
+* jobs: the jobs array
+*
+* max_jobs: the maximum number of jobs
+*/
+void print_jobs_long(job_t *jobs, int max_jobs);
+
 /*
 * get_job_pid: get the process id of a job in the jobs array based on the job id provided
 *
@@ -106,4 +264,84 @@ pid_t get_job_pid(job_t *jobs, int max_jobs, int jid);
 */
 int get_job_jid(job_t *jobs, int max_jobs, pid_t pid);
 
+/*
+* find_job: find a job in the jobs array based on the process id provided
+*
+* jobs: the jobs array
+*
+* max_jobs: the maximum number of jobs
+*
+* pid: the process id of the job to find
+*
+* returns: the job if the job was found, NULL if the job was not found. It stays valid until the job is deleted or the jobs array grows
+*/
+job_t *find_job(job_t *jobs, int max_jobs, pid_t pid);
+
+// Represents a background job waiting for a free slot in the jobs array
+typedef struct queued_job {
+    char *path;                 // The resolved path of the program to execute
+    char **argv;                // The arguments of the command, allocated together with their strings
+    char *cmd_line;             // The command line for this specific job
+    bool capture;               // The output of the job is captured once it is launched
+    long timeout_ms;            // The deadline of the job counted from its launch, 0 for none
+    struct queued_job *next;    // The job queued after this one
+}queued_job_t;
+
+// Represents the FIFO admission queue of background jobs
+typedef struct job_queue {
+    queued_job_t *head;
+    queued_job_t *tail;
+    int count;
+}job_queue_t;
+
+/*
+* alloc_job_queue: allocates and initializes an empty admission queue
+*
+* returns: a job_queue_t pointer that is allocated and initialized
+*/
+job_queue_t *alloc_job_queue(void);
+
+/*
+* enqueue_job: copy a command to the back of the admission queue
+*
+* queue: the admission queue
+*
+* path: the resolved path of the program to execute
+*
+* argv: the arguments of the command, terminated by NULL
+*
+* cmd_line: the command line of the job
+*/
+void enqueue_job(job_queue_t *queue, const char *path, char **argv, const char *cmd_line);
+
+/*
+* dequeue_job: remove the command at the front of the admission queue
+*
+* queue: the admission queue
+*
+* returns: the queued job to be freed with free_queued_job, or NULL if the queue is empty
+*/
+queued_job_t *dequeue_job(job_queue_t *queue);
+
+/*
+* free_queued_job: free a job returned by dequeue_job
+*
+* job: the queued job
+*/
+void free_queued_job(queued_job_t *job);
+
+/*
+* print_job_queue: print the queued jobs in the order they will be launched
+*
+* queue: the admission queue
+*/
+void print_job_queue(job_queue_t *queue);
+
+/*
+* free_job_queue: free the admission queue and every job still queued
+*
+* queue: the admission queue
+*/
+void free_job_queue(job_queue_t *queue);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef _LAUNCH_H_
+#define _LAUNCH_H_
+
+#include <sys/types.h>
+#include <signal.h>
+
+// Selects how the shell starts external commands
+typedef enum launch_mode{LAUNCH_SPAWN, LAUNCH_FORK} launch_mode_t;
+
+/*
+* parse_launch_mode: convert the value of the -X option into a launch mode
+*
+* name: the name of the launcher backend, either "spawn" or "fork"
+*
+* mode: stores the parsed launch mode at the memory location of the mode pointer
+*
+* Returns: 0 if the name was recognised, 1 otherwise
+*/
+int parse_launch_mode(const char *name, launch_mode_t *mode);
+
+/*
+* launch_process: start a command in a new process group whose group ID is identical to its PID,
+* or in the process group of an earlier stage of the same pipeline
+*
+* mode: the launcher backend to use
+*
+* path: the path of the program to execute
+*
+* argv: the arguments of the command
+*
+* child_mask: the signal mask the child starts with (i.e. the mask before SIGCHLD was blocked)
+*
+* pgid: the process group to join, 0 to start a new one
+*
+* fds: the file descriptors the child gets as its stdin, stdout and stderr, -1 (or fds NULL) keeps
+* the one of the shell. They should be close-on-exec so the child gets no other copy of them.
+*
+* Returns: the process id of the child, or -1 if the command could not be started
+*/
+pid_t launch_process(launch_mode_t mode, const char *path, char **argv, const sigset_t *child_mask, pid_t pgid, const int *fds);
+
+#endif
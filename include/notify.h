@@ -0,0 +1,46 @@
+#ifndef _NOTIFY_H_
+#define _NOTIFY_H_
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+// The number of notifications kept before they are written out, a power of two
+#define NOTIFY_RING_SIZE 1024
+
+// The state changes of jobs the user is told about
+typedef enum job_event {JOB_DONE, JOB_STOPPED, JOB_CONTINUED, JOB_TIMED_OUT} job_event_t;
+
+// Represents a pending job notification (i.e. pid 1234 Done)
+typedef struct notification {
+    pid_t pid;
+    job_event_t event;
+}notification_t;
+
+/*
+* notify_job: queue a notification, it is written by the next flush_notifications. If the queue is full,
+* the queued notifications are moved to the stdout buffer first.
+*
+* pid: the process id of the job
+*
+* event: what happened to the job
+*/
+void notify_job(pid_t pid, job_event_t event);
+
+/*
+* notifications_pending: check whether notifications are waiting to be written
+*
+* Returns: true if flush_notifications has something to write
+*/
+bool notifications_pending(void);
+
+/*
+* flush_notifications: write every queued notification, followed by the prompt
+*
+* direct: write with a single writev after flushing stdout (for a terminal), or add the
+* notifications to the stdout buffer (when stdout is fully buffered)
+*
+* prompt: the prompt to write after the notifications, NULL for none. It is written even if no notification is queued.
+*/
+void flush_notifications(bool direct, const char *prompt);
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef _PATH_CACHE_H_
+#define _PATH_CACHE_H_
+
+#include <stdbool.h>
+#include <time.h>
+
+// Represents a remembered command location, chained inside a hash bucket
+typedef struct path_entry {
+    char *name;                 // The command name as typed by the user
+    char *path;                 // The resolved path of the command
+    int dir_index;              // The index of the PATH directory the command was found in, -1 if set with hash -p
+    unsigned long generation;   // The generation of the cache when the command was resolved
+    int hits;                   // The number of times the entry was used to launch a command
+    struct path_entry *next;    // The next entry in the same bucket
+}path_entry_t;
+
+// Represents a directory of PATH and the modification time it had when it was last looked at
+typedef struct path_dir {
+    char *name;                 // The directory, "." for an empty PATH component
+    struct timespec mtime;      // Zero if the directory does not exist
+    unsigned long changed;      // The generation of the cache in which mtime was last seen to change
+}path_dir_t;
+
+// Represents the hash table from command names to resolved paths (i.e. the hash builtin)
+typedef struct path_cache {
+    path_entry_t **buckets;
+    int num_buckets;
+    int count;
+    char *path_env;             // The PATH value the entries were resolved against
+    path_dir_t *dirs;           // The directories of path_env in search order
+    int num_dirs;
+    unsigned long generation;   // Incremented whenever a directory is seen to have changed
+}path_cache_t;
+
+/*
+* alloc_path_cache: allocates and initializes an empty command path cache
+*
+* Returns: a path_cache_t pointer that is allocated and initialized
+*/
+path_cache_t *alloc_path_cache(void);
+
+/*
+* path_cache_lookup: resolve a command name to the path that should be executed
+*
+* cache: the command path cache
+*
+* name: the command name (i.e. argv[0]). Names containing a '/' are returned unchanged.
+*
+* Returns: the resolved path, or NULL if the command cannot be found in PATH.
+* The entry is dropped and resolved again if PATH changed, or if the directory it was found in
+* or any directory before it in PATH changed (i.e. a command of the same name was added to it).
+*/
+const char *path_cache_lookup(path_cache_t *cache, const char *name);
+
+/*
+* path_cache_add: search PATH for the command and remember its location without running it
+*
+* cache: the command path cache
+*
+* name: the command name
+*
+* Returns: true if the command was found, false otherwise
+*/
+bool path_cache_add(path_cache_t *cache, const char *name);
+
+/*
+* path_cache_set: remember the given path for the command name (i.e. hash -p path name)
+*
+* cache: the command path cache
+*
+* name: the command name
+*
+* path: the path to use for the command name
+*/
+void path_cache_set(path_cache_t *cache, const char *name, const char *path);
+
+/*
+* path_cache_clear: forget all remembered locations (i.e. hash -r)
+*
+* cache: the command path cache
+*/
+void path_cache_clear(path_cache_t *cache);
+
+/*
+* print_path_cache: print the remembered locations
+*
+* cache: the command path cache
+*
+* reusable: true to print entries as hash -p commands that can be read back (i.e. hash -l),
+* false to print the number of hits of each entry
+*/
+void print_path_cache(path_cache_t *cache, bool reusable);
+
+/*
+* free_path_cache: free the command path cache and all allocated memory
+*
+* cache: the command path cache
+*/
+void free_path_cache(path_cache_t *cache);
+
+#endif
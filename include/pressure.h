@@ -0,0 +1,60 @@
+#ifndef _PRESSURE_H_
+#define _PRESSURE_H_
+
+#include <stdbool.h>
+#include <stdio.h>
+
+// Represents how loaded the host is, as read from /proc
+typedef struct pressure {
+    double cpu;         // The share of time some task waited for a CPU over the last 10 seconds (PSI avg10), in percent, -1 if unknown
+    double memory;      // The share of time some task stalled on memory over the last 10 seconds (PSI avg10), in percent, -1 if unknown
+    double load;        // The load average over the last minute, -1 if unknown
+}pressure_t;
+
+// Represents the readings above which the host counts as overloaded, a limit of 0 ignores the reading
+typedef struct pressure_limits {
+    double cpu;
+    double memory;
+    double load;
+}pressure_limits_t;
+
+/*
+* parse_psi: find the 10 second average of the "some" line of a pressure stall information file
+*
+* text: the contents of the file, i.e. "some avg10=1.50 avg60=0.80 avg300=0.20 total=12345\n..."
+*
+* Returns: the average in percent, -1 if text has no such line
+*/
+double parse_psi(const char *text);
+
+/*
+* read_pressure: read the CPU and memory pressure from /proc/pressure and the load average from /proc/loadavg.
+* The files are opened once and read again on every call.
+*
+* pressure: set to the readings, the ones the kernel does not provide are -1
+*/
+void read_pressure(pressure_t *pressure);
+
+/*
+* over_limits: check whether any reading is above its limit, unknown readings and limits of 0 are ignored
+*
+* pressure: the readings
+*
+* limits: the limits
+*
+* Returns: true if the host is overloaded
+*/
+bool over_limits(const pressure_t *pressure, const pressure_limits_t *limits);
+
+/*
+* print_pressure: print every reading next to its limit
+*
+* out: the stream to print to
+*
+* pressure: the readings
+*
+* limits: the limits
+*/
+void print_pressure(FILE *out, const pressure_t *pressure, const pressure_limits_t *limits);
+
+#endif
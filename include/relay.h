@@ -0,0 +1,17 @@
+#ifndef _RELAY_H_
+#define _RELAY_H_
+
+/*
+* start_relay: move the output of a pipeline stage to the input of the next one through the shell,
+* with splice so the bytes are never copied to user space. The relay runs from the event loop
+* and closes its file descriptors once both inputs reached end of file or the next stage exited.
+*
+* out_fd: the read end of the pipe the stage writes its stdout to
+*
+* err_fd: the read end of the pipe the stage writes its stderr to (for |&), or -1
+*
+* next_fd: the write end of the pipe the next stage reads from
+*/
+void start_relay(int out_fd, int err_fd, int next_fd);
+
+#endif
@@ -10,31 +10,65 @@
 #include <sys/wait.h>
 #include "job.h"
 #include "history.h"
+#include "launch.h"
+#include "event_loop.h"
+#include "input.h"
+#include "arena.h"
+#include "classify.h"
+#include "path_cache.h"
 #include "signal_handlers.h"
+#include "fast_builtins.h"
+#include "zygote.h"
+#include "relay.h"
+#include "stats.h"
+#include "notify.h"
+#include "pressure.h"
 #include "csapp.h"
 #include <signal.h>
 
+// How long a job whose deadline passed has to exit after SIGTERM before it gets SIGKILL
+#define TIMEOUT_GRACE_MS 2000
+// How often the scheduler reads the pressure again while it holds background jobs (set -o sched)
+#define SCHED_POLL_MS 1000
+
 // Represents the state of the shell
 typedef struct msh {
    int max_jobs;
+   int max_jobs_limit;
    int max_line;
    int max_history;
+   launch_mode_t launch_mode;
    job_t *jobs;
+   job_queue_t *job_queue;
    history_t *history;
+   path_cache_t *path_cache;
+   input_t *input;
+   arena_t *line_arena;
+   bool fast_builtins;
+   zygote_t *zygote;
+   bool relay;
+   bool interactive;    // Cleared when commands come from a script, -c or input that is not a terminal: no prompts, stdout fully buffered
+   bool notify;         // Report job state changes as soon as they happen (set -b), otherwise only before the next prompt
+   bool capture;        // Capture the output of every background job (set -o capture), not only of the ones started with &>
+   long timeout_ms;     // The deadline of every job not run with the timeout builtin (set -o timeout SECONDS), 0 for none
+   bool sched;          // Hold new background jobs in the admission queue while the host is overloaded (set -o sched)
+   pressure_limits_t sched_limits;  // The pressure and load above which the host counts as overloaded, set with the sched builtin
 }msh_t;
 
 /*
 * alloc_shell: allocates and initializes the state of the shell
 *
-* max_jobs: The maximum number of jobs that can be in existence at any point in time.
+* max_jobs: The initial number of jobs that can be in existence at any point in time, the jobs array grows on demand.
 *
 * max_line: The maximum number of characters that can be entered for any specific command line.
 *
 * max_history: The maximum number of saved history commands for the shell.
 *
+* use_zygote: Launch external commands through a zygote process forked before the shell state is allocated.
+*
 * Returns: a msh_t pointer that is allocated and initialized
 */
-msh_t *alloc_shell(int max_jobs, int max_line, int max_history);
+msh_t *alloc_shell(int max_jobs, int max_line, int max_history, bool use_zygote);
 
 /**
 * parse_tok: Continuously retrieves separate commands from the provided command line until all commands are parsed
@@ -49,6 +83,76 @@ msh_t *alloc_shell(int max_jobs, int max_line, int max_history);
 */
 char *parse_tok(char *line, int *job_type);
 
+/**
+* parse_tok_r: reentrant version of parse_tok, the position in the command line is kept in saveptr instead of a static variable
+*
+* line: the command line to parse on the first call, NULL to continue parsing the same command line
+*
+* job_type: same as parse_tok
+*
+* saveptr: the position in the command line, set by the first call and passed unchanged to the next calls
+*
+* Returns: same as parse_tok
+*/
+char *parse_tok_r(char *line, int *job_type, char **saveptr);
+
+/**
+* count_args: count the words of a command line, which bounds the number of arguments of every command in it
+*
+* line: the command line, which may include multiple commands separated by '&' or ';'
+*
+* Returns: the number of words in line
+*/
+int count_args(const char *line);
+
+/**
+* lex_command: splits the next command off a command line and separates its arguments in a single pass
+*
+* cursor: the position in the command line, to be set to the line before the first call. It is set to NULL after the last command.
+*
+* argv: filled with the arguments of the command followed by NULL, it must have room for count_args(line) + 1 pointers
+*
+* job_type: set to 0 if the command ends with '&' (i.e. a background job), 2 if it ends with '&>' (a background job
+* whose output is captured), 1 otherwise
+*
+* Returns: the number of arguments of the command, 0 for an empty command.
+*
+* Please note this function does modify the command line and never allocates memory.
+*/
+int lex_command(char **cursor, char **argv, int *job_type);
+
+/**
+* index_line: classify every character of a command line into the bitmask index used by lex_command_indexed
+*
+* arena: the arena the index is allocated from
+*
+* line: the command line
+*
+* len: the length of the command line
+*
+* Returns: the index of line, valid until the arena is released
+*/
+line_index_t *index_line(arena_t *arena, char *line, size_t len);
+
+/**
+* count_args_indexed: same as count_args, using the bitmask index of the command line
+*
+* index: the index returned by index_line
+*
+* Returns: the number of words in the command line
+*/
+int count_args_indexed(const line_index_t *index);
+
+/**
+* lex_command_indexed: same as lex_command, but finds the words and separators with the bitmask index
+* of the command line instead of looking at every character, which is faster on long command lines
+*
+* index: the index returned by index_line, the command line must not have been modified before
+*
+* cursor, argv, job_type and Returns: same as lex_command
+*/
+int lex_command_indexed(const line_index_t *index, char **cursor, char **argv, int *job_type);
+
 /**
 * separate_args: Separates the arguments of command and places them in an allocated array returned by this function
 *
@@ -63,6 +167,22 @@ char *parse_tok(char *line, int *job_type);
 */
 char **separate_args(char *line, int *argc, bool *is_builtin);
 
+/*
+* split_pipeline: split the arguments of a command into the stages of a pipeline at the operators | and |&,
+* which do not need whitespace around them
+*
+* arena: the arena the stages are allocated from
+*
+* argv: the arguments of the command, the operators are overwritten in place
+*
+* stages: set to the arguments of each stage, each terminated by NULL
+*
+* merge_stderr: set to whether each stage also sends its stderr to the next stage (|&)
+*
+* Returns: the number of stages, 1 if the command is not a pipeline (stages is left unset), or -1 if a stage is empty
+*/
+int split_pipeline(arena_t *arena, char **argv, char ****stages, bool **merge_stderr);
+
 /*
 * evaluate - executes the provided command line string
 *
@@ -84,6 +204,13 @@ otherwise, chosen command line history.
 */
 char *builtin_cmd(char **argv);
 
+/*
+* admit_queued_jobs - launches queued background jobs while the jobs array has room
+*
+* shell - the current shell state value
+*/
+void admit_queued_jobs(msh_t *shell);
+
 /*
 * exit_shell - Closes down the shell by deallocating the shell state.
 *
@@ -1,9 +1,60 @@
 #ifndef _SIGNAL_HANDLERS_H_
 #define _SIGNAL_HANDLERS_H_
 
+#include <signal.h>
+#include <sys/resource.h>
 #include "job.h"
 #include "shell.h"
 
+/*
+* initialize_signal_handlers: installs the SIGINT and SIGTSTP handlers, and blocks SIGCHLD so
+* child state changes are read from a signalfd registered with the event loop
+*/
 void initialize_signal_handlers();
 
+/*
+* child_signal_mask: the signal mask external commands start with, i.e. the mask of the shell before SIGCHLD was blocked
+*/
+const sigset_t *child_signal_mask(void);
+
+/*
+* watch_child: track a job with a pidfd registered with the event loop, so its termination
+* is handled without scanning the other children
+*
+* pid: the process id of a job that was just added to the jobs array. Jobs launched by the zygote
+* are not children of the shell, they are left to watch_zygote.
+*/
+void watch_child(pid_t pid);
+
+/*
+* watch_zygote: handle the state changes the zygote forwards for the jobs it launched
+* like those of children of the shell
+*
+* event_fd: the event socket of the zygote
+*/
+void watch_zygote(int event_fd);
+
+/*
+* job_exited: delete a job that terminated from the jobs array and notify the user
+*
+* pid: the process id of the job, or of one of the stages of a pipeline
+*
+* usage: the resources used by the process as returned by wait4, NULL if there was no process (i.e. a pseudo job)
+*/
+void job_exited(pid_t pid, const struct rusage *usage);
+
+/*
+* job_stopped: mark a job as suspended and notify the user
+*
+* pid: the process id of the job
+*/
+void job_stopped(pid_t pid);
+
+/*
+* job_continued: mark a suspended job as running again and notify the user
+*
+* pid: the process id of the job
+*/
+void job_continued(pid_t pid);
+
 #endif
\ No newline at end of file
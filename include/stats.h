@@ -0,0 +1,87 @@
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+// Values below 2^HISTOGRAM_SUB_BITS nanoseconds get a bucket each, every larger power of two is split
+// into 2^HISTOGRAM_SUB_BITS buckets, so a recorded value is off by at most 1/16th (about 6%)
+#define HISTOGRAM_SUB_BITS 4
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS ((64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS)
+
+// Represents a log-bucketed (HDR style) histogram of durations in nanoseconds
+typedef struct histogram {
+    uint64_t counts[HISTOGRAM_BUCKETS];
+    uint64_t count;     // The number of values recorded
+    uint64_t max;       // The largest value recorded, exactly
+}histogram_t;
+
+// The phases of the hot path of the shell that are timed
+typedef enum stat_phase {
+    STAT_EVALUATE,  // A whole command line in evaluate, without the time spent waiting for foreground jobs
+    STAT_PARSE,     // Splitting a command into its arguments (the lexers, parse_tok and separate_args)
+    STAT_LAUNCH,    // Starting an external command until the launcher returns, exec included for posix_spawn
+    STAT_REAP,      // Handling a child state change from the wakeup of the event loop to the job table update
+    STAT_PHASES
+}stat_phase_t;
+
+extern histogram_t phase_stats[STAT_PHASES];
+
+/*
+* stats_now: read the monotonic clock
+*
+* Returns: the time in nanoseconds
+*/
+static inline uint64_t stats_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+// The timing of the hot path is compiled out with -DMSH_NO_STATS, the stats builtin then has nothing to print
+#ifdef MSH_NO_STATS
+#define STATS_START() 0
+#define STATS_RECORD(phase, start) ((void)(start))
+#else
+#define STATS_START() stats_now()
+#define STATS_RECORD(phase, start) histogram_record(&phase_stats[phase], stats_now() - (start))
+#endif
+
+/*
+* histogram_record: add a value to a histogram
+*
+* histogram: the histogram
+*
+* value: the duration in nanoseconds
+*/
+void histogram_record(histogram_t *histogram, uint64_t value);
+
+/*
+* histogram_percentile: find the value below which a share of the recorded values fall
+*
+* histogram: the histogram
+*
+* percentile: the share of values in percent, between 0 and 100
+*
+* Returns: the upper bound of the bucket holding the percentile (never more than the maximum), 0 if the histogram is empty
+*/
+uint64_t histogram_percentile(const histogram_t *histogram, double percentile);
+
+/*
+* reset_stats: forget every value recorded for the phases
+*/
+void reset_stats(void);
+
+/*
+* print_stats: print the count, p50, p99 and maximum of each phase
+*
+* out: the stream to print to
+*
+* json: print one JSON object per phase (i.e. {"phase":"parse","count":3,...}) instead of a table
+*/
+void print_stats(FILE *out, bool json);
+
+#endif
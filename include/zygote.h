@@ -0,0 +1,59 @@
+#ifndef _ZYGOTE_H_
+#define _ZYGOTE_H_
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include <sys/resource.h>
+#include "launch.h"
+
+// Represents the helper process that launches external commands on behalf of the shell
+typedef struct zygote {
+    pid_t pid;
+    int request_fd;   // Stream socket the launch requests are sent on and the pids read from
+    int event_fd;     // Packet socket the state changes of the launched children arrive on
+}zygote_t;
+
+// A state change of a child of the zygote, code is the si_code of waitid (CLD_EXITED, CLD_STOPPED, ...)
+typedef struct zygote_event {
+    pid_t pid;
+    int code;
+    struct rusage usage;    // The resources the child used, as returned by wait4 when it was reaped
+}zygote_event_t;
+
+/*
+* start_zygote: fork the zygote, which should happen before the shell allocates its state so
+* the zygote stays small. The zygote exits when the shell closes its sockets or dies.
+*
+* Returns: the zygote, or NULL if it could not be started. The caller reads event_fd (non-blocking).
+*/
+zygote_t *start_zygote(void);
+
+/*
+* zygote_launch: ask the zygote to start a command like launch_process does, with the environment of the shell
+*
+* zygote: the zygote returned by start_zygote
+*
+* mode: the launcher backend the zygote uses
+*
+* path: the path of the program to execute
+*
+* argv: the arguments of the command
+*
+* pgid: the process group to join, 0 to start a new one
+*
+* fds: the stdin, stdout and stderr of the child (-1 or fds NULL keeps the ones of the zygote), passed to the zygote
+*
+* more_stages: true if more stages of the same pipeline follow, false for the last stage or a single command
+*
+* Returns: the process id of the child, or -1 if the command could not be started
+*/
+pid_t zygote_launch(zygote_t *zygote, launch_mode_t mode, const char *path, char **argv, pid_t pgid, const int *fds, bool more_stages);
+
+/*
+* stop_zygote: close the sockets of the zygote, wait for it to exit and free it
+*
+* zygote: the zygote returned by start_zygote
+*/
+void stop_zygote(zygote_t *zygote);
+
+#endif
@@ -0,0 +1,82 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdalign.h>
+
+// The size of the first chunk, larger allocations get a chunk of their own size
+#define ARENA_CHUNK_SIZE 16384
+
+alloc_stats_t alloc_stats;
+
+arena_t *alloc_arena(void) {
+    arena_t *arena = malloc(sizeof(arena_t));
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->used = 0;
+    return arena;
+}
+
+void *arena_alloc(arena_t *arena, size_t size) {
+    // Keep every allocation aligned for any type
+    size = (size + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1);
+    if (arena->current == NULL || arena->used + size > arena->current->size) {
+        // Move to the next chunk, reusing the chunks kept by arena_release when they are large enough
+        arena_chunk_t *chunk = arena->current == NULL ? arena->first : arena->current->next;
+        while (chunk != NULL && chunk->size < size) {
+            chunk = chunk->next;
+        }
+        if (chunk == NULL) {
+            // Allocate a chunk twice as large as the previous one, and at least as large as size
+            size_t chunk_size = arena->current == NULL ? ARENA_CHUNK_SIZE : 2 * arena->current->size;
+            if (chunk_size < size) {
+                chunk_size = size;
+            }
+            chunk = malloc(sizeof(arena_chunk_t) + chunk_size);
+            chunk->size = chunk_size;
+            // Insert the chunk after the current one
+            if (arena->current == NULL) {
+                chunk->next = arena->first;
+                arena->first = chunk;
+            } else {
+                chunk->next = arena->current->next;
+                arena->current->next = chunk;
+            }
+            alloc_stats.arena_chunks++;
+        }
+        arena->current = chunk;
+        arena->used = 0;
+    }
+    void *ptr = arena->current->data + arena->used;
+    arena->used += size;
+    alloc_stats.arena_allocs++;
+    alloc_stats.arena_bytes += size;
+    return ptr;
+}
+
+char *arena_strdup(arena_t *arena, const char *str) {
+    size_t len = strlen(str);
+    char *copy = arena_alloc(arena, len + 1);
+    memcpy(copy, str, len + 1);
+    return copy;
+}
+
+arena_mark_t arena_mark(arena_t *arena) {
+    arena_mark_t mark = {arena->current, arena->used};
+    return mark;
+}
+
+void arena_release(arena_t *arena, arena_mark_t mark) {
+    arena->current = mark.chunk;
+    arena->used = mark.used;
+    alloc_stats.arena_releases++;
+}
+
+void free_arena(arena_t *arena) {
+    arena_chunk_t *chunk = arena->first;
+    while (chunk != NULL) {
+        arena_chunk_t *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(arena);
+}
@@ -0,0 +1,162 @@
+#define _GNU_SOURCE
+#include "capture.h"
+#include "event_loop.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+static void grow(capture_t *capture) {
+    // Helper function to double the ring, the kept output moves to the start of the new one
+    size_t size = capture->size == 0 ? CAPTURE_MIN_SIZE : capture->size * 2;
+    char *buf = malloc(size);
+    const char *first, *second;
+    size_t first_len, second_len;
+    capture_view(capture, &first, &first_len, &second, &second_len);
+    memcpy(buf, first, first_len);
+    memcpy(buf + first_len, second, second_len);
+    free(capture->buf);
+    capture->buf = buf;
+    capture->size = size;
+    capture->tail = 0;
+    capture->head = first_len + second_len;
+}
+
+static void write_tagged(capture_t *capture, const char *data, size_t len, FILE *out) {
+    // Helper function to write output line by line, every line starts with the job number
+    while (len > 0) {
+        if (capture->line_start) {
+            fprintf(out, "[%d] ", capture->jid);
+        }
+        const char *newline = memchr(data, '\n', len);
+        size_t n = newline != NULL ? (size_t)(newline - data) + 1 : len;
+        fwrite(data, 1, n, out);
+        capture->line_start = newline != NULL;
+        data += n;
+        len -= n;
+    }
+}
+
+static void capture_event(int fd, void *data) {
+    capture_read((capture_t *)data);
+}
+
+capture_t *start_capture(int *write_fd) {
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) < 0) {
+        return NULL;
+    }
+    // Only the shell end is non-blocking, the job blocks once the pipe is full like on a terminal
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    capture_t *capture = calloc(1, sizeof(capture_t));
+    capture->fd = fds[0];
+    capture->line_start = true;
+    event_loop_add_fd(fds[0], capture_event, capture);
+    *write_fd = fds[1];
+    return capture;
+}
+
+void capture_read(capture_t *capture) {
+    while (capture->fd != -1) {
+        ssize_t n;
+        if (capture->live) {
+            // The job is in the foreground, its output goes straight out
+            char chunk[4096];
+            n = read(capture->fd, chunk, sizeof(chunk));
+            if (n > 0) {
+                write_tagged(capture, chunk, n, stdout);
+                continue;
+            }
+        } else {
+            if (capture->head - capture->tail == capture->size && capture->size < CAPTURE_LIMIT) {
+                grow(capture);
+            }
+            // Read into the ring in place, once it reached its limit the oldest output is overwritten
+            size_t offset = capture->head & (capture->size - 1);
+            size_t room = capture->size - offset;
+            if (capture->size < CAPTURE_LIMIT && capture->size - (capture->head - capture->tail) < room) {
+                room = capture->size - (capture->head - capture->tail);
+            }
+            n = read(capture->fd, capture->buf + offset, room);
+            if (n > 0) {
+                capture->head += n;
+                if (capture->head - capture->tail > capture->size) {
+                    capture->dropped += capture->head - capture->tail - capture->size;
+                    capture->tail = capture->head - capture->size;
+                }
+                continue;
+            }
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && errno == EAGAIN) {
+            return;
+        }
+        // End of file, the job and every process it started closed the pipe
+        event_loop_remove_fd(capture->fd);
+        close(capture->fd);
+        capture->fd = -1;
+    }
+}
+
+void capture_view(const capture_t *capture, const char **first, size_t *first_len, const char **second, size_t *second_len) {
+    size_t len = capture->head - capture->tail;
+    size_t offset = capture->size == 0 ? 0 : capture->tail & (capture->size - 1);
+    *first = capture->buf + offset;
+    *first_len = len < capture->size - offset ? len : capture->size - offset;
+    *second = capture->buf;
+    *second_len = len - *first_len;
+}
+
+void print_capture(const capture_t *capture, int fd) {
+    struct iovec iov[2];
+    capture_view(capture, (const char **)&iov[0].iov_base, &iov[0].iov_len, (const char **)&iov[1].iov_base, &iov[1].iov_len);
+    // Whatever the shell printed before must come first
+    fflush(stdout);
+    writev(fd, iov, 2);
+}
+
+void replay_capture(capture_t *capture, FILE *out) {
+    if (capture->dropped > 0) {
+        if (!capture->line_start) {
+            fputc('\n', out);
+        }
+        fprintf(out, "[%d] ... %lu bytes dropped\n", capture->jid, capture->dropped);
+        capture->line_start = true;
+        capture->dropped = 0;
+    }
+    const char *first, *second;
+    size_t first_len, second_len;
+    capture_view(capture, &first, &first_len, &second, &second_len);
+    write_tagged(capture, first, first_len, out);
+    write_tagged(capture, second, second_len, out);
+    capture->tail = capture->head;
+}
+
+void capture_foreground(capture_t *capture, bool live) {
+    if (live) {
+        // What the job wrote while it ran in the background comes first
+        capture_read(capture);
+        replay_capture(capture, stdout);
+    }
+    capture->live = live;
+}
+
+void end_capture(capture_t *capture) {
+    capture_read(capture);
+    // A process the job started in the background may still hold the pipe, its later output is lost
+    if (capture->fd != -1) {
+        event_loop_remove_fd(capture->fd);
+        close(capture->fd);
+    }
+    replay_capture(capture, stdout);
+    // The last line is ended even if the job did not end it
+    if (!capture->line_start) {
+        fputc('\n', stdout);
+    }
+    free(capture->buf);
+    free(capture);
+}
@@ -0,0 +1,150 @@
+#include "classify.h"
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CLASSIFY_X86 1
+#endif
+
+typedef void classifier_t(const char *line, size_t len, uint64_t *spaces, uint64_t *separators);
+
+// Bit 0 is set for whitespace characters, bit 1 for job separators
+static const uint8_t char_classes[256] = {
+    [' '] = 1, ['\t'] = 1, ['\n'] = 1, ['\v'] = 1, ['\f'] = 1, ['\r'] = 1, ['&'] = 2, [';'] = 2,
+};
+
+static void classify_scalar(const char *line, size_t len, uint64_t *spaces, uint64_t *separators) {
+    // Build one word of each mask per 64 characters
+    size_t words = (len + 63) / 64;
+    const unsigned char *chars = (const unsigned char *)line;
+    for (size_t w = 0; w < words; w++) {
+        uint64_t space = 0;
+        uint64_t separator = 0;
+        size_t end = len - w * 64 < 64 ? len - w * 64 : 64;
+        for (size_t i = 0; i < end; i++) {
+            uint64_t class = char_classes[chars[w * 64 + i]];
+            space |= (class & 1) << i;
+            separator |= (class >> 1) << i;
+        }
+        spaces[w] = space;
+        separators[w] = separator;
+    }
+}
+
+#ifdef CLASSIFY_X86
+static void classify_tail(const char *line, size_t len, size_t done, uint64_t *spaces, uint64_t *separators) {
+    // Classify the characters after the last full 64 byte block with the scalar classifier
+    if (done < len) {
+        classify_scalar(line + done, len - done, spaces + done / 64, separators + done / 64);
+    }
+}
+
+static void classify_sse2(const char *line, size_t len, uint64_t *spaces, uint64_t *separators) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i four = _mm_set1_epi8(4);
+    const __m128i amp = _mm_set1_epi8('&');
+    const __m128i semi = _mm_set1_epi8(';');
+    size_t done = 0;
+    for (; done + 64 <= len; done += 64) {
+        uint64_t space_bits = 0;
+        uint64_t separator_bits = 0;
+        for (int i = 0; i < 4; i++) {
+            __m128i chars = _mm_loadu_si128((const __m128i *)(line + done + i * 16));
+            // '\t' to '\r' are the characters whose distance to '\t' is at most 4 when compared unsigned
+            __m128i offset = _mm_sub_epi8(chars, tab);
+            __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(offset, four), offset);
+            __m128i is_space = _mm_or_si128(_mm_cmpeq_epi8(chars, space), control);
+            __m128i is_separator = _mm_or_si128(_mm_cmpeq_epi8(chars, amp), _mm_cmpeq_epi8(chars, semi));
+            space_bits |= (uint64_t)(uint16_t)_mm_movemask_epi8(is_space) << (i * 16);
+            separator_bits |= (uint64_t)(uint16_t)_mm_movemask_epi8(is_separator) << (i * 16);
+        }
+        spaces[done / 64] = space_bits;
+        separators[done / 64] = separator_bits;
+    }
+    classify_tail(line, len, done, spaces, separators);
+}
+
+__attribute__((target("avx2")))
+static void classify_avx2(const char *line, size_t len, uint64_t *spaces, uint64_t *separators) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i four = _mm256_set1_epi8(4);
+    const __m256i amp = _mm256_set1_epi8('&');
+    const __m256i semi = _mm256_set1_epi8(';');
+    size_t done = 0;
+    for (; done + 64 <= len; done += 64) {
+        uint64_t space_bits = 0;
+        uint64_t separator_bits = 0;
+        for (int i = 0; i < 2; i++) {
+            __m256i chars = _mm256_loadu_si256((const __m256i *)(line + done + i * 32));
+            __m256i offset = _mm256_sub_epi8(chars, tab);
+            __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(offset, four), offset);
+            __m256i is_space = _mm256_or_si256(_mm256_cmpeq_epi8(chars, space), control);
+            __m256i is_separator = _mm256_or_si256(_mm256_cmpeq_epi8(chars, amp), _mm256_cmpeq_epi8(chars, semi));
+            space_bits |= (uint64_t)(uint32_t)_mm256_movemask_epi8(is_space) << (i * 32);
+            separator_bits |= (uint64_t)(uint32_t)_mm256_movemask_epi8(is_separator) << (i * 32);
+        }
+        spaces[done / 64] = space_bits;
+        separators[done / 64] = separator_bits;
+    }
+    classify_tail(line, len, done, spaces, separators);
+}
+#endif
+
+// The classifier picked on the first call, NULL until then
+static classifier_t *classifier = NULL;
+static const char *classifier_name = NULL;
+
+static void pick_classifier(void) {
+#ifdef CLASSIFY_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        classifier = classify_avx2;
+        classifier_name = "avx2";
+        return;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        classifier = classify_sse2;
+        classifier_name = "sse2";
+        return;
+    }
+#endif
+    classifier = classify_scalar;
+    classifier_name = "scalar";
+}
+
+void classify_line(const char *line, size_t len, uint64_t *spaces, uint64_t *separators) {
+    if (classifier == NULL) {
+        pick_classifier();
+    }
+    classifier(line, len, spaces, separators);
+}
+
+const char *classify_backend(void) {
+    if (classifier == NULL) {
+        pick_classifier();
+    }
+    return classifier_name;
+}
+
+bool classify_set_backend(const char *name) {
+    if (strcmp(name, "scalar") == 0) {
+        classifier = classify_scalar;
+        classifier_name = "scalar";
+        return true;
+    }
+#ifdef CLASSIFY_X86
+    __builtin_cpu_init();
+    if (strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2")) {
+        classifier = classify_sse2;
+        classifier_name = "sse2";
+        return true;
+    }
+    if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")) {
+        classifier = classify_avx2;
+        classifier_name = "avx2";
+        return true;
+    }
+#endif
+    return false;
+}
@@ -0,0 +1,254 @@
+#include "event_loop.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+// Represents a watched file descriptor
+typedef struct watcher {
+    event_handler_t *handler;   // NULL if the file descriptor is not watched
+    void *data;
+    bool always_ready;          // Regular files cannot be added to epoll and are always readable
+    bool paused;
+    unsigned int events;        // EPOLLIN, or EPOLLOUT for writers
+}watcher_t;
+
+// Represents a pending timer, kept in a min-heap ordered by deadline
+typedef struct timer {
+    long long deadline_ns;      // CLOCK_MONOTONIC time the timer expires at
+    timer_handler_t *handler;   // NULL if the timer slot is free
+    void *data;
+    int heap_pos;               // The position of the timer in the heap
+}loop_timer_t;
+
+static int epoll_fd = -1;
+static int timer_fd = -1;
+static watcher_t *watchers = NULL;
+static int num_watchers = 0;
+static int num_always_ready = 0;
+static loop_timer_t *timers = NULL;
+static int num_timers = 0;
+static int *heap = NULL;        // Timer ids, the earliest deadline first
+static int heap_len = 0;
+static int *free_timers = NULL; // Stack of free timer ids
+static int num_free_timers = 0;
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void timer_fd_event(int fd, void *data);
+
+void event_loop_init(void) {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (epoll_fd == -1 || timer_fd == -1) {
+        perror("event loop error");
+        exit(1);
+    }
+    event_loop_add_fd(timer_fd, timer_fd_event, NULL);
+}
+
+static void watch_events(int fd, int op, unsigned int events) {
+    struct epoll_event event;
+    event.events = events;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd, op, fd, &event) == -1) {
+        perror("epoll_ctl error");
+    }
+}
+
+static void add_watcher(int fd, unsigned int events, event_handler_t *handler, void *data) {
+    if (fd >= num_watchers) {
+        int old_num = num_watchers;
+        num_watchers = fd + 16;
+        watchers = realloc(watchers, num_watchers * sizeof(watcher_t));
+        memset(watchers + old_num, 0, (num_watchers - old_num) * sizeof(watcher_t));
+    }
+    watchers[fd].handler = handler;
+    watchers[fd].data = data;
+    watchers[fd].paused = false;
+    watchers[fd].always_ready = false;
+    watchers[fd].events = events;
+    struct epoll_event event;
+    event.events = events;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+        if (errno != EPERM) {
+            perror("epoll_ctl error");
+        }
+        // epoll refuses regular files (i.e. msh < script), reading them never blocks
+        watchers[fd].always_ready = true;
+        num_always_ready++;
+    }
+}
+
+void event_loop_add_fd(int fd, event_handler_t *handler, void *data) {
+    add_watcher(fd, EPOLLIN, handler, data);
+}
+
+void event_loop_add_writer(int fd, event_handler_t *handler, void *data) {
+    add_watcher(fd, EPOLLOUT, handler, data);
+}
+
+void event_loop_remove_fd(int fd) {
+    if (fd < 0 || fd >= num_watchers || watchers[fd].handler == NULL) {
+        return;
+    }
+    if (watchers[fd].always_ready) {
+        // A paused always ready fd is not counted anymore
+        num_always_ready -= watchers[fd].paused ? 0 : 1;
+    } else {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    }
+    watchers[fd].handler = NULL;
+}
+
+void event_loop_pause_fd(int fd, bool paused) {
+    if (fd < 0 || fd >= num_watchers || watchers[fd].handler == NULL || watchers[fd].paused == paused) {
+        return;
+    }
+    watchers[fd].paused = paused;
+    if (watchers[fd].always_ready) {
+        num_always_ready += paused ? -1 : 1;
+    } else {
+        // A level-triggered readable fd would wake up every wait, so stop watching it for now
+        watch_events(fd, EPOLL_CTL_MOD, paused ? 0 : watchers[fd].events);
+    }
+}
+
+static void heap_swap(int a, int b) {
+    int id = heap[a];
+    heap[a] = heap[b];
+    heap[b] = id;
+    timers[heap[a]].heap_pos = a;
+    timers[heap[b]].heap_pos = b;
+}
+
+static void heap_sift(int pos) {
+    // Move the timer at pos up or down until the heap is ordered again
+    while (pos > 0 && timers[heap[pos]].deadline_ns < timers[heap[(pos - 1) / 2]].deadline_ns) {
+        heap_swap(pos, (pos - 1) / 2);
+        pos = (pos - 1) / 2;
+    }
+    while (true) {
+        int smallest = pos;
+        int left = 2 * pos + 1;
+        int right = 2 * pos + 2;
+        if (left < heap_len && timers[heap[left]].deadline_ns < timers[heap[smallest]].deadline_ns) {
+            smallest = left;
+        }
+        if (right < heap_len && timers[heap[right]].deadline_ns < timers[heap[smallest]].deadline_ns) {
+            smallest = right;
+        }
+        if (smallest == pos) {
+            return;
+        }
+        heap_swap(pos, smallest);
+        pos = smallest;
+    }
+}
+
+static void arm_timer_fd(void) {
+    // The timerfd always fires at the earliest deadline, or is disarmed if there are no timers
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (heap_len > 0) {
+        long long deadline = timers[heap[0]].deadline_ns;
+        spec.it_value.tv_sec = deadline / 1000000000LL;
+        spec.it_value.tv_nsec = deadline % 1000000000LL;
+    }
+    timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, NULL);
+}
+
+static void heap_remove(int id) {
+    int pos = timers[id].heap_pos;
+    heap_len--;
+    if (pos != heap_len) {
+        heap[pos] = heap[heap_len];
+        timers[heap[pos]].heap_pos = pos;
+        heap_sift(pos);
+    }
+    timers[id].handler = NULL;
+    free_timers[num_free_timers++] = id;
+}
+
+int event_loop_add_timer(long delay_ms, timer_handler_t *handler, void *data) {
+    // Reuse a free timer slot, or grow the slots
+    if (num_free_timers == 0) {
+        int old_num = num_timers;
+        num_timers = num_timers == 0 ? 16 : num_timers * 2;
+        timers = realloc(timers, num_timers * sizeof(loop_timer_t));
+        heap = realloc(heap, num_timers * sizeof(int));
+        free_timers = realloc(free_timers, num_timers * sizeof(int));
+        for (int i = num_timers - 1; i >= old_num; i--) {
+            timers[i].handler = NULL;
+            free_timers[num_free_timers++] = i;
+        }
+    }
+    int id = free_timers[--num_free_timers];
+    timers[id].deadline_ns = now_ns() + delay_ms * 1000000LL;
+    timers[id].handler = handler;
+    timers[id].data = data;
+    timers[id].heap_pos = heap_len;
+    heap[heap_len++] = id;
+    heap_sift(heap_len - 1);
+    arm_timer_fd();
+    return id;
+}
+
+void event_loop_cancel_timer(int id) {
+    if (id < 0 || id >= num_timers || timers[id].handler == NULL) {
+        return;
+    }
+    heap_remove(id);
+    arm_timer_fd();
+}
+
+static void timer_fd_event(int fd, void *data) {
+    uint64_t expirations;
+    if (read(fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+        perror("timerfd read error");
+    }
+    // Run every timer whose deadline passed, a handler may add or cancel timers
+    long long now = now_ns();
+    while (heap_len > 0 && timers[heap[0]].deadline_ns <= now) {
+        int id = heap[0];
+        timer_handler_t *handler = timers[id].handler;
+        void *handler_data = timers[id].data;
+        heap_remove(id);
+        handler(handler_data);
+    }
+    arm_timer_fd();
+}
+
+void event_loop_run_once(int timeout_ms) {
+    // Do not block when a regular file still has data to be read
+    if (num_always_ready > 0) {
+        timeout_ms = 0;
+    }
+    struct epoll_event events[16];
+    int num_events = epoll_wait(epoll_fd, events, 16, timeout_ms);
+    if (num_events == -1 && errno != EINTR) {
+        perror("epoll_wait error");
+    }
+    for (int i = 0; i < num_events; i++) {
+        int fd = events[i].data.fd;
+        // A previous handler may have removed or paused this file descriptor
+        if (fd < num_watchers && watchers[fd].handler != NULL && !watchers[fd].paused) {
+            watchers[fd].handler(fd, watchers[fd].data);
+        }
+    }
+    for (int fd = 0; num_always_ready > 0 && fd < num_watchers; fd++) {
+        if (watchers[fd].handler != NULL && watchers[fd].always_ready && !watchers[fd].paused) {
+            watchers[fd].handler(fd, watchers[fd].data);
+        }
+    }
+}
@@ -0,0 +1,353 @@
+#include "fast_builtins.h"
+#include "shell.h"
+#include <errno.h>
+#include <time.h>
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <signal.h>
+
+extern msh_t *shell;
+
+// Represents a sleep running as a pseudo job
+typedef struct pseudo_job {
+    pid_t pid;
+    int timer;              // The event loop timer, -1 while the job is suspended
+    long long deadline_ns;  // CLOCK_MONOTONIC time the sleep ends at while it runs
+    long remaining_ms;      // The time left to sleep while the job is suspended
+}pseudo_job_t;
+
+static pseudo_job_t *pseudo_jobs = NULL;
+static int num_pseudo_jobs = 0;
+static int pseudo_jobs_size = 0;
+static pid_t next_pseudo_pid = PSEUDO_PID_BASE;
+
+static const char *utility_name(const char *path) {
+    // Helper function to get the utility a command names, NAME, /bin/NAME and /usr/bin/NAME all name NAME
+    if (strncmp(path, "/usr/bin/", 9) == 0) {
+        path += 9;
+    } else if (strncmp(path, "/bin/", 5) == 0) {
+        path += 5;
+    }
+    return strchr(path, '/') == NULL ? path : "";
+}
+
+static const char *print_escape(const char *s, bool *stop) {
+    // Helper function to print the backslash escape at s, returns the first character after it
+    // \c stops the output altogether (stop is set)
+    switch (s[1]) {
+        case 'a': putchar('\a'); return s + 2;
+        case 'b': putchar('\b'); return s + 2;
+        case 'c': *stop = true; return s + 2;
+        case 'e': putchar('\033'); return s + 2;
+        case 'f': putchar('\f'); return s + 2;
+        case 'n': putchar('\n'); return s + 2;
+        case 'r': putchar('\r'); return s + 2;
+        case 't': putchar('\t'); return s + 2;
+        case 'v': putchar('\v'); return s + 2;
+        case '\\': putchar('\\'); return s + 2;
+        case '0': {
+            // Up to three octal digits after \0
+            int value = 0;
+            s += 2;
+            for (int i = 0; i < 3 && *s >= '0' && *s <= '7'; i++, s++) {
+                value = value * 8 + (*s - '0');
+            }
+            putchar(value);
+            return s;
+        }
+        default:
+            putchar('\\');
+            return s + 1;
+    }
+}
+
+static bool print_escaped(const char *s) {
+    // Helper function to print a string interpreting backslash escapes, returns false if \c stopped the output
+    bool stop = false;
+    while (*s != '\0' && !stop) {
+        if (*s == '\\' && s[1] != '\0') {
+            s = print_escape(s, &stop);
+        } else {
+            putchar(*s++);
+        }
+    }
+    return !stop;
+}
+
+static void echo_builtin(char **argv) {
+    // echo [-neE] [STRING]...
+    bool newline = true;
+    bool escapes = false;
+    int i = 1;
+    for (; argv[i] != NULL && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
+        // Options are only taken from arguments made of n, e and E
+        if (strspn(argv[i] + 1, "neE") != strlen(argv[i] + 1)) {
+            break;
+        }
+        for (const char *c = argv[i] + 1; *c != '\0'; c++) {
+            newline = newline && *c != 'n';
+            escapes = *c == 'e' ? true : (*c == 'E' ? false : escapes);
+        }
+    }
+    for (; argv[i] != NULL; i++) {
+        if (escapes) {
+            if (!print_escaped(argv[i])) {
+                return;
+            }
+        } else {
+            fputs(argv[i], stdout);
+        }
+        if (argv[i + 1] != NULL) {
+            putchar(' ');
+        }
+    }
+    if (newline) {
+        putchar('\n');
+    }
+}
+
+static void printf_builtin(char **argv) {
+    // printf FORMAT [ARGUMENT]..., the format is reused while arguments are left
+    if (argv[1] == NULL) {
+        printf("printf: missing operand\n");
+        return;
+    }
+    const char *format = argv[1];
+    char **args = argv + 2;
+    do {
+        char **first = args;
+        for (const char *s = format; *s != '\0';) {
+            bool stop = false;
+            if (*s == '\\') {
+                s = print_escape(s, &stop);
+                if (stop) {
+                    return;
+                }
+                continue;
+            }
+            if (*s != '%') {
+                putchar(*s++);
+                continue;
+            }
+            if (s[1] == '%') {
+                putchar('%');
+                s += 2;
+                continue;
+            }
+            // Copy the conversion with its flags, width and precision, and print one argument with it
+            char spec[32];
+            size_t n = strspn(s + 1, "-+ #0123456789.") + 1;
+            char conversion = s[n];
+            if (conversion == '\0' || n + 3 > sizeof(spec)) {
+                fputs(s, stdout);
+                break;
+            }
+            const char *arg = *args != NULL ? *args++ : NULL;
+            memcpy(spec, s, n);
+            s += n + 1;
+            switch (conversion) {
+                case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+                    spec[n] = 'l';
+                    spec[n + 1] = conversion;
+                    spec[n + 2] = '\0';
+                    if (conversion == 'c') {
+                        spec[n] = 'c';
+                        spec[n + 1] = '\0';
+                        printf(spec, arg != NULL ? arg[0] : '\0');
+                    } else {
+                        printf(spec, arg != NULL ? strtol(arg, NULL, 0) : 0L);
+                    }
+                    break;
+                case 'f': case 'e': case 'g': case 'E': case 'G':
+                    spec[n] = conversion;
+                    spec[n + 1] = '\0';
+                    printf(spec, arg != NULL ? strtod(arg, NULL) : 0.0);
+                    break;
+                case 'b':
+                    if (arg != NULL && !print_escaped(arg)) {
+                        return;
+                    }
+                    break;
+                default:
+                    spec[n] = 's';
+                    spec[n + 1] = '\0';
+                    printf(spec, arg != NULL ? arg : "");
+                    break;
+            }
+        }
+        // Stop when the format did not use any argument
+        if (args == first) {
+            break;
+        }
+    } while (*args != NULL);
+}
+
+static bool printf_supported(const char *format) {
+    // Helper function to check that every conversion has its width and precision in the format,
+    // the ones taken from the arguments (i.e. %*d) are left to the program
+    for (const char *s = strchr(format, '%'); s != NULL; s = strchr(s, '%')) {
+        if (s[1] == '%') {
+            s += 2;
+            continue;
+        }
+        size_t n = strspn(s + 1, "-+ #0123456789.*");
+        if (memchr(s + 1, '*', n) != NULL) {
+            return false;
+        }
+        s += n + 1;
+    }
+    return true;
+}
+
+bool run_fast_builtin(char **argv) {
+    const char *name = utility_name(argv[0]);
+    if (strcmp(name, "true") == 0 || strcmp(name, "false") == 0) {
+        // The shell does not keep exit statuses, there is nothing to do
+        return true;
+    } else if (strcmp(name, "echo") == 0) {
+        echo_builtin(argv);
+        return true;
+    } else if (strcmp(name, "printf") == 0 && (argv[1] == NULL || printf_supported(argv[1]))) {
+        printf_builtin(argv);
+        return true;
+    }
+    return false;
+}
+
+double parse_interval(const char *arg) {
+    // A number followed by an optional unit
+    char *end;
+    errno = 0;
+    double seconds = strtod(arg, &end);
+    double unit = 1;
+    if (*end == 'm') {
+        unit = 60;
+    } else if (*end == 'h') {
+        unit = 3600;
+    } else if (*end == 'd') {
+        unit = 86400;
+    }
+    if (*end != '\0' && *end != 's' && unit == 1) {
+        end = (char *)arg;
+    } else if (*end != '\0') {
+        end++;
+    }
+    if (end == arg || *end != '\0' || errno != 0 || !(seconds >= 0)) {
+        return -1;
+    }
+    return seconds * unit;
+}
+
+bool sleep_duration(char **argv, long *ms) {
+    if (strcmp(utility_name(argv[0]), "sleep") != 0) {
+        return false;
+    }
+    if (argv[1] == NULL) {
+        printf("sleep: missing operand\n");
+        *ms = -1;
+        return true;
+    }
+    // The intervals are added up
+    double total = 0;
+    for (int i = 1; argv[i] != NULL; i++) {
+        double seconds = parse_interval(argv[i]);
+        if (seconds < 0) {
+            printf("sleep: invalid time interval '%s'\n", argv[i]);
+            *ms = -1;
+            return true;
+        }
+        total += seconds;
+    }
+    *ms = total * 1000 > (double)LONG_MAX / 2 ? LONG_MAX / 2 : (long)(total * 1000 + 0.999);
+    return true;
+}
+
+static pseudo_job_t *find_pseudo_job(pid_t pid) {
+    for (int i = 0; i < num_pseudo_jobs; i++) {
+        if (pseudo_jobs[i].pid == pid) {
+            return &pseudo_jobs[i];
+        }
+    }
+    return NULL;
+}
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void forget_pseudo_job(pseudo_job_t *job) {
+    // Move the last pseudo job into the place of job
+    *job = pseudo_jobs[--num_pseudo_jobs];
+}
+
+static void pseudo_job_expired(void *data) {
+    pid_t pid = (pid_t)(intptr_t)data;
+    pseudo_job_t *job = find_pseudo_job(pid);
+    if (job != NULL) {
+        forget_pseudo_job(job);
+    }
+    job_exited(pid, NULL);
+    // Launch background jobs that were waiting for the slot freed above
+    if (shell->job_queue->count > 0) {
+        admit_queued_jobs(shell);
+    }
+}
+
+pid_t start_pseudo_job(long ms) {
+    if (num_pseudo_jobs == pseudo_jobs_size) {
+        pseudo_jobs_size = pseudo_jobs_size == 0 ? 8 : 2 * pseudo_jobs_size;
+        pseudo_jobs = realloc(pseudo_jobs, pseudo_jobs_size * sizeof(pseudo_job_t));
+    }
+    pseudo_job_t *job = &pseudo_jobs[num_pseudo_jobs++];
+    // Pseudo pids wrap around well before overflowing
+    job->pid = next_pseudo_pid;
+    next_pseudo_pid = next_pseudo_pid == INT_MAX ? PSEUDO_PID_BASE : next_pseudo_pid + 1;
+    job->deadline_ns = now_ns() + ms * 1000000LL;
+    job->remaining_ms = 0;
+    job->timer = event_loop_add_timer(ms, pseudo_job_expired, (void *)(intptr_t)job->pid);
+    return job->pid;
+}
+
+bool is_pseudo_job(pid_t pid) {
+    return pid >= PSEUDO_PID_BASE;
+}
+
+bool signal_pseudo_job(pid_t pid, int sig) {
+    pseudo_job_t *job = find_pseudo_job(pid);
+    if (job == NULL) {
+        return false;
+    }
+    if (sig == SIGSTOP || sig == SIGTSTP) {
+        // Suspend the sleep and remember how long is left
+        if (job->timer != -1) {
+            event_loop_cancel_timer(job->timer);
+            job->timer = -1;
+            long long left = job->deadline_ns - now_ns();
+            job->remaining_ms = left > 0 ? (left + 999999) / 1000000 : 0;
+            job_stopped(pid);
+        }
+    } else if (sig == SIGCONT) {
+        // Resume the sleep for the time that was left
+        if (job->timer == -1) {
+            job->deadline_ns = now_ns() + job->remaining_ms * 1000000LL;
+            job->timer = event_loop_add_timer(job->remaining_ms, pseudo_job_expired, (void *)(intptr_t)pid);
+            job_continued(pid);
+        }
+    } else if (sig != 0) {
+        // Any other signal terminates the sleep
+        if (job->timer != -1) {
+            event_loop_cancel_timer(job->timer);
+        }
+        forget_pseudo_job(job);
+        job_exited(pid, NULL);
+        if (shell->job_queue->count > 0) {
+            admit_queued_jobs(shell);
+        }
+    }
+    return true;
+}
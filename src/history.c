@@ -1,64 +1,436 @@
+#define _GNU_SOURCE
 #include "history.h"
+#include "arena.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 const char *HISTORY_FILE_PATH = "../data/.msh_history";
+// Used when HISTORY_FILE_PATH cannot be opened (i.e. the shell runs from the repository root)
+static const char *FALLBACK_HISTORY_FILE_PATH = "./data/.msh_history";
+
+// Initial size of the arena, it doubles whenever the lines no longer fit in half of it
+static const size_t INITIAL_ARENA_SIZE = 4096;
+// Set in an offset of the ring when it points into the mapped history file instead of the arena
+static const size_t MAPPED_LINE = (size_t)1 << (sizeof(size_t) * 8 - 1);
+
+static void compact_file(history_t *history);
 
 history_t *alloc_history(int max_history) {
     // Allocate memory for history
     history_t *history = malloc(sizeof(history_t));
-    history->lines = malloc(max_history * sizeof(char *));
+    history->arena_size = INITIAL_ARENA_SIZE;
+    history->arena = malloc(history->arena_size);
+    history->arena_used = 0;
+    history->live_bytes = 0;
+    history->offsets = malloc(max_history * sizeof(size_t));
+    history->first = 0;
     history->max_history = max_history;
     history->next = 0;
+    history->file_lines = 0;
+    history->pending = NULL;
+    history->pending_len = 0;
+    history->pending_size = 0;
+    history->pending_lines = 0;
+    history->commit_lines = 1;
+    history->fsync_commits = 0;
+    history->commits = 0;
+    history->map = NULL;
+    history->map_size = 0;
+    history->mapped_lines = 0;
+    history->added = 0;
+    history->index = NULL;
 
-    // Read in history commands from file and insert into lines
-    FILE *fp = fopen(HISTORY_FILE_PATH, "r");
-    if (fp == NULL) {
-        // File does not exist, return history
-        return history; 
-    }
-    // File exists, read in history commands
-    char *line = NULL;
-    long int len = 0;
-    long nread = getline(&line, &len, fp);
-    while (nread != -1 && history->next < history->max_history) {
-        // Add line to history
-        add_line_history(history, line);
-        // Free line
-        free(line);
-        line = NULL;
-        // Read next line
-        nread = getline(&line, &len, fp);
-    }
-    // Close file
-    fclose(fp);
+    // Open the history file for appending, creating it if it does not exist
+    history->file_path = HISTORY_FILE_PATH;
+    history->fd = open(history->file_path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (history->fd == -1) {
+        history->file_path = FALLBACK_HISTORY_FILE_PATH;
+        history->fd = open(history->file_path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+        if (history->fd == -1) {
+            // Keep the history in memory only
+            perror("Error opening history file");
+            return history;
+        }
+    }
+    // Map the history file and index its last max_history lines, the lines
+    // themselves are only copied into the arena once they are used
+    bool ends_with_newline = true;
+    int map_fd = open(history->file_path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (map_fd != -1 && fstat(map_fd, &st) == 0 && st.st_size > 0) {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, map_fd, 0);
+        if (map != MAP_FAILED) {
+            history->map = map;
+            history->map_size = st.st_size;
+        }
+    }
+    if (map_fd != -1) {
+        close(map_fd);
+    }
+    if (history->map != NULL) {
+        const char *pos = history->map;
+        const char *end = history->map + history->map_size;
+        // memchr compares a whole vector of bytes at a time when searching for newlines
+        while (pos < end) {
+            if (history->next < history->max_history) {
+                history->offsets[history->next] = (size_t)(pos - history->map) | MAPPED_LINE;
+                history->next++;
+                history->mapped_lines++;
+            } else if (history->max_history > 0) {
+                // The history is full, the line replaces the oldest one like an added line would
+                history->offsets[history->first] = (size_t)(pos - history->map) | MAPPED_LINE;
+                history->first = (history->first + 1) % history->max_history;
+            }
+            history->file_lines++;
+            const char *newline = memchr(pos, '\n', end - pos);
+            if (newline == NULL) {
+                break;
+            }
+            pos = newline + 1;
+        }
+        ends_with_newline = end[-1] == '\n';
+        history->added = history->next;
+        if (history->mapped_lines == 0) {
+            munmap((void *)history->map, history->map_size);
+            history->map = NULL;
+        }
+    }
+    if (history->file_lines > history->next) {
+        // Lines before the last max_history are not in the history, drop them
+        // so the file holds the same lines as the history
+        compact_file(history);
+    } else if (!ends_with_newline) {
+        // Terminate the last line so the next appended line starts on its own line
+        if (write(history->fd, "\n", 1) != 1) {
+            perror("Error writing history file");
+        }
+    }
     return history;
 }
 
-void add_line_history(history_t *history, const char *cmd_line) {
-    if (cmd_line == NULL) {
-        return;
+static size_t *offset_at(history_t *history, int i) {
+    // Returns the ring entry of the i-th oldest line, starting from 0
+    return &history->offsets[(history->first + i) % history->max_history];
+}
+
+static const char *line_text(history_t *history, int i, size_t *len) {
+    // Returns the i-th oldest line wherever it is stored, its length is stored at len
+    size_t offset = *offset_at(history, i);
+    if (offset & MAPPED_LINE) {
+        // Lines in the mapped file end at a newline or at the end of the file
+        const char *line = history->map + (offset & ~MAPPED_LINE);
+        const char *end = history->map + history->map_size;
+        const char *newline = memchr(line, '\n', end - line);
+        *len = (newline == NULL ? end : newline) - line;
+        return line;
     }
-    // If history is full, remove the first line
-    // Then shift all lines up by 1
+    const char *line = history->arena + offset;
+    *len = strlen(line);
+    return line;
+}
+
+static void release_mapped_line(history_t *history) {
+    // Unmap the history file once no line in the history is read from it
+    history->mapped_lines--;
+    if (history->mapped_lines == 0) {
+        munmap((void *)history->map, history->map_size);
+        history->map = NULL;
+        history->map_size = 0;
+    }
+}
+
+static void compact_arena(history_t *history, size_t needed) {
+    // Copy the lines still in the history to the front of a new arena that has room
+    // for twice the live bytes, so compaction is amortized over many added lines
+    size_t arena_size = history->arena_size;
+    while (arena_size < 2 * (history->live_bytes + needed)) {
+        arena_size *= 2;
+    }
+    char *arena = malloc(arena_size);
+    alloc_stats.pool_mallocs++;
+    size_t used = 0;
+    for (int i = 0; i < history->next; i++) {
+        size_t *offset = offset_at(history, i);
+        // Lines still in the mapped file are not in the arena
+        if (*offset & MAPPED_LINE) {
+            continue;
+        }
+        char *line = history->arena + *offset;
+        size_t len = strlen(line) + 1;
+        memcpy(arena + used, line, len);
+        *offset = used;
+        used += len;
+    }
+    free(history->arena);
+    history->arena = arena;
+    history->arena_size = arena_size;
+    history->arena_used = used;
+}
+
+static size_t copy_to_arena(history_t *history, const char *text, size_t len) {
+    // Copy len bytes of text as a '\0' terminated line and return its arena offset
+    if (history->arena_used + len + 1 > history->arena_size) {
+        compact_arena(history, len + 1);
+    }
+    size_t offset = history->arena_used;
+    memcpy(history->arena + offset, text, len);
+    history->arena[offset + len] = '\0';
+    history->arena_used += len + 1;
+    history->live_bytes += len + 1;
+    return offset;
+}
+
+static char *line_at(history_t *history, int i) {
+    // Returns the i-th oldest line, copying it out of the mapped history file the first time
+    size_t *offset = offset_at(history, i);
+    if (*offset & MAPPED_LINE) {
+        size_t len;
+        const char *text = line_text(history, i, &len);
+        size_t arena_offset = copy_to_arena(history, text, len);
+        // The arena may have been compacted, look the ring entry up again
+        *offset_at(history, i) = arena_offset;
+        release_mapped_line(history);
+    }
+    return history->arena + *offset_at(history, i);
+}
+
+static unsigned int seq_at(history_t *history, int i) {
+    // Returns the sequence number of the i-th oldest line, starting from 0
+    return history->added - history->next + 1 + i;
+}
+
+static void build_index(history_t *history) {
+    // Index every line in the history, mapped lines are read in place
+    history->index = alloc_history_index();
+    for (int i = 0; i < history->next; i++) {
+        size_t len;
+        const char *line = line_text(history, i, &len);
+        history_index_add(history->index, seq_at(history, i), line, len);
+    }
+}
+
+static void store_line(history_t *history, const char *cmd_line) {
+    // If history is full, drop the oldest line by moving the start of the ring
     if (history->next == history->max_history) {
-        free(history->lines[0]);
-        for (int i = 0; i < history->next - 1; i++) {
-            history->lines[i] = history->lines[i+1];
+        if (*offset_at(history, 0) & MAPPED_LINE) {
+            release_mapped_line(history);
+        } else {
+            history->live_bytes -= strlen(line_at(history, 0)) + 1;
         }
+        history->first = (history->first + 1) % history->max_history;
         history->next--;
     }
     // Copy command line up to newline character (i.e. not copy newline character)
-    int len = strcspn(cmd_line, "\n");
-    // strdup allocates memory for the string copied over, to be freed later
-    history->lines[history->next] = strndup(cmd_line, len);
+    size_t len = strcspn(cmd_line, "\n");
+    size_t offset = copy_to_arena(history, cmd_line, len);
+    *offset_at(history, history->next) = offset;
     history->next++;
+    history->added++;
+    if (history->index != NULL) {
+        // Lines that fell out of the history stay in the index until it is rebuilt, which
+        // happens once it holds twice as many lines as the history so the cost is amortized
+        if (history->index->lines_indexed >= 2 * history->max_history) {
+            free_history_index(history->index);
+            build_index(history);
+        } else {
+            history_index_add(history->index, history->added, history->arena + offset, len);
+        }
+    }
+}
+
+static bool write_all(int fd, const char *buf, size_t len) {
+    // Write the whole buffer, O_APPEND writes of a regular file are not split by other writers
+    while (len > 0) {
+        ssize_t written = write(fd, buf, len);
+        if (written < 0) {
+            return false;
+        }
+        buf += written;
+        len -= written;
+    }
+    return true;
+}
+
+void flush_history(history_t *history) {
+    if (history->fd == -1 || history->pending_lines == 0) {
+        return;
+    }
+    // Group commit: all pending lines go out in a single append
+    if (!write_all(history->fd, history->pending, history->pending_len)) {
+        perror("Error writing history file");
+    }
+    history->file_lines += history->pending_lines;
+    history->pending_len = 0;
+    history->pending_lines = 0;
+    history->commits++;
+    if (history->fsync_commits != 0 && history->commits >= history->fsync_commits) {
+        fsync(history->fd);
+        history->commits = 0;
+    }
+}
+
+static void compact_file(history_t *history) {
+    // Rewrite the history file with only the lines in the history, into a temporary
+    // file that replaces it atomically so a crash never leaves a truncated history
+    char tmp_path[256];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", history->file_path);
+    FILE *fp = fopen(tmp_path, "w");
+    if (fp == NULL) {
+        perror("Error compacting history file");
+        return;
+    }
+    for (int i = 0; i < history->next; i++) {
+        size_t len;
+        const char *line = line_text(history, i, &len);
+        fwrite(line, 1, len, fp);
+        fputc('\n', fp);
+    }
+    if (fclose(fp) != 0 || rename(tmp_path, history->file_path) != 0) {
+        perror("Error compacting history file");
+        remove(tmp_path);
+        return;
+    }
+    // Keep appending to the new file
+    close(history->fd);
+    history->fd = open(history->file_path, O_WRONLY | O_APPEND | O_CLOEXEC);
+    history->file_lines = history->next;
+    // Lines waiting for their group commit were just written with the others
+    history->pending_len = 0;
+    history->pending_lines = 0;
+}
+
+void add_line_history(history_t *history, const char *cmd_line) {
+    if (cmd_line == NULL) {
+        return;
+    }
+    store_line(history, cmd_line);
+    if (history->fd == -1) {
+        return;
+    }
+    // Queue the line for the history file, terminated by a newline
+    char *line = line_at(history, history->next - 1);
+    size_t len = strlen(line);
+    if (history->pending_len + len + 1 > history->pending_size) {
+        history->pending_size = 2 * (history->pending_len + len + 1);
+        history->pending = realloc(history->pending, history->pending_size);
+        alloc_stats.pool_mallocs++;
+    }
+    memcpy(history->pending + history->pending_len, line, len);
+    history->pending[history->pending_len + len] = '\n';
+    history->pending_len += len + 1;
+    history->pending_lines++;
+    if (history->pending_lines >= history->commit_lines) {
+        flush_history(history);
+    }
+    // Once the file holds twice as many lines as the history, rewrite it with the history
+    // only, so the file stays bounded while the cost of rewriting is spread over many lines
+    if (history->file_lines >= 2 * history->max_history) {
+        compact_file(history);
+    }
+}
+
+void set_history_commit(history_t *history, int commit_lines, int fsync_commits) {
+    // Pending lines must still be in the history when they are written
+    if (commit_lines > history->max_history) {
+        commit_lines = history->max_history;
+    }
+    history->commit_lines = commit_lines < 1 ? 1 : commit_lines;
+    history->fsync_commits = fsync_commits < 0 ? 0 : fsync_commits;
+    if (history->pending_lines >= history->commit_lines) {
+        flush_history(history);
+    }
+}
+
+int search_history_prefix(history_t *history, const char *prefix) {
+    if (history->index == NULL) {
+        build_index(history);
+    }
+    size_t prefix_len = strlen(prefix);
+    unsigned int oldest = seq_at(history, 0);
+    if (prefix_len <= HISTORY_TRIE_DEPTH) {
+        // The trie knows the most recent line with the prefix, if it left the history so did all others
+        unsigned int seq = history_index_prefix(history->index, prefix, prefix_len);
+        return seq < oldest ? 0 : (int)(seq - oldest) + 1;
+    }
+    // Prefixes longer than the trie are matched like patterns and checked from the newest line
+    const unsigned int *seqs;
+    int count = history_index_candidates(history->index, prefix, prefix_len, &seqs);
+    for (int i = count - 1; i >= 0 && seqs[i] >= oldest; i--) {
+        size_t len;
+        const char *line = line_text(history, seqs[i] - oldest, &len);
+        if (len >= prefix_len && memcmp(line, prefix, prefix_len) == 0) {
+            return (int)(seqs[i] - oldest) + 1;
+        }
+    }
+    return 0;
+}
+
+static bool line_contains(history_t *history, int i, const char *pattern, size_t pattern_len) {
+    size_t len;
+    const char *line = line_text(history, i, &len);
+    return memmem(line, len, pattern, pattern_len) != NULL;
+}
+
+int search_history_substring(history_t *history, const char *pattern) {
+    if (history->index == NULL) {
+        build_index(history);
+    }
+    size_t pattern_len = strlen(pattern);
+    unsigned int oldest = seq_at(history, 0);
+    const unsigned int *seqs;
+    int count = history_index_candidates(history->index, pattern, pattern_len, &seqs);
+    if (count == -1) {
+        // Patterns shorter than a trigram are checked against every line
+        for (int i = history->next - 1; i >= 0; i--) {
+            if (line_contains(history, i, pattern, pattern_len)) {
+                return i + 1;
+            }
+        }
+        return 0;
+    }
+    // Check the candidates from the newest line, stopping at lines that left the history
+    for (int i = count - 1; i >= 0 && seqs[i] >= oldest; i--) {
+        if (line_contains(history, seqs[i] - oldest, pattern, pattern_len)) {
+            return (int)(seqs[i] - oldest) + 1;
+        }
+    }
+    return 0;
+}
+
+void print_history_matches(history_t *history, const char *pattern) {
+    if (history->index == NULL) {
+        build_index(history);
+    }
+    size_t pattern_len = strlen(pattern);
+    unsigned int oldest = seq_at(history, 0);
+    const unsigned int *seqs;
+    int count = history_index_candidates(history->index, pattern, pattern_len, &seqs);
+    for (int i = 0; i < (count == -1 ? history->next : count); i++) {
+        // Without candidates every line is checked, otherwise skip the lines that left the history
+        int line_index = count == -1 ? i : (int)(seqs[i] - oldest);
+        if (count != -1 && seqs[i] < oldest) {
+            continue;
+        }
+        if (line_contains(history, line_index, pattern, pattern_len)) {
+            size_t len;
+            const char *line = line_text(history, line_index, &len);
+            printf("%5d\t%.*s\n", line_index + 1, (int)len, line);
+        }
+    }
 }
 
 void print_history(history_t *history) {
     for(int i = 1; i <= history->next; i++) {
-        printf("%5d\t%s\n",i,history->lines[i-1]);
+        // Print lines still in the mapped file without copying them
+        size_t len;
+        const char *line = line_text(history, i-1, &len);
+        printf("%5d\t%.*s\n",i,(int)len,line);
     }
 }
 
@@ -67,34 +439,32 @@ char *find_line_history(history_t *history, int index) {
         // Return NULL if index is out of bounds
         return NULL;
     }
-    return history->lines[index-1];
+    // The returned line stays valid until the next line is added
+    return line_at(history, index-1);
 }
 
 void free_history(history_t *history) {
-    FILE * fp = fopen(HISTORY_FILE_PATH, "w");
-    // Check if file opened successfully
-    if (fp == NULL) {
-        char *updated_path = "./data/.msh_history";
-        fp = fopen(updated_path, "w");
-        if (fp == NULL) {
-            perror("Error opening history file");
-            exit(EXIT_FAILURE);
+    if (history->fd != -1) {
+        // Every line was appended as it was added, only the last group commit is left
+        flush_history(history);
+        // Drop the lines that fell out of the history since the file was last compacted
+        if (history->file_lines > history->max_history) {
+            compact_file(history);
+        }
+        if (history->fsync_commits != 0) {
+            fsync(history->fd);
         }
+        close(history->fd);
     }
-    // Write history to file
-    for (int i = 0; i < history->next; i++) {
-        // Write line to file
-        fprintf(fp, "%s", history->lines[i]);
-        if (i < history->next - 1) {
-            // Add new line character if not last line
-            fputc('\n', fp);
-        }
-        // Free respective line
-        free(history->lines[i]);
-    }
-    // Close file
-    fclose(fp);
-    // Free remaining memory
-    free(history->lines);
+    if (history->map != NULL) {
+        munmap((void *)history->map, history->map_size);
+    }
+    if (history->index != NULL) {
+        free_history_index(history->index);
+    }
+    // Free remaining memory, all other lines live in the arena
+    free(history->pending);
+    free(history->arena);
+    free(history->offsets);
     free(history);
 }
@@ -0,0 +1,155 @@
+#include "history_index.h"
+#include <stdlib.h>
+#include <string.h>
+
+static unsigned int trigram_at(const char *text) {
+    // Pack three bytes into one key, the extra bit keeps the key of "\0\0\0" non zero
+    return (1u << 24) | ((unsigned char)text[0] << 16) | ((unsigned char)text[1] << 8) | (unsigned char)text[2];
+}
+
+static int posting_bucket(history_index_t *index, unsigned int trigram) {
+    // Linear probing, stops at the bucket holding trigram or at the first empty bucket
+    int mask = index->postings_size - 1;
+    int bucket = (int)((trigram * 2654435761u) >> 8) & mask;
+    while (index->postings[bucket].trigram != 0 && index->postings[bucket].trigram != trigram) {
+        bucket = (bucket + 1) & mask;
+    }
+    return bucket;
+}
+
+static void grow_postings(history_index_t *index) {
+    // Double the hash table and move every posting list to its new bucket
+    posting_list_t *old = index->postings;
+    int old_size = index->postings_size;
+    index->postings_size *= 2;
+    index->postings = calloc(index->postings_size, sizeof(posting_list_t));
+    for (int i = 0; i < old_size; i++) {
+        if (old[i].trigram != 0) {
+            index->postings[posting_bucket(index, old[i].trigram)] = old[i];
+        }
+    }
+    free(old);
+}
+
+static int new_node(history_index_t *index, unsigned char c) {
+    if (index->num_nodes == index->nodes_size) {
+        index->nodes_size *= 2;
+        index->nodes = realloc(index->nodes, index->nodes_size * sizeof(trie_node_t));
+    }
+    trie_node_t *node = &index->nodes[index->num_nodes];
+    node->c = c;
+    node->child = -1;
+    node->sibling = -1;
+    node->max_seq = 0;
+    return index->num_nodes++;
+}
+
+static int find_child(history_index_t *index, int parent, unsigned char c) {
+    int child = index->nodes[parent].child;
+    while (child != -1 && index->nodes[child].c != c) {
+        child = index->nodes[child].sibling;
+    }
+    return child;
+}
+
+history_index_t *alloc_history_index(void) {
+    history_index_t *index = malloc(sizeof(history_index_t));
+    index->postings_size = 1024;
+    index->postings = calloc(index->postings_size, sizeof(posting_list_t));
+    index->num_postings = 0;
+    index->nodes_size = 1024;
+    index->nodes = malloc(index->nodes_size * sizeof(trie_node_t));
+    index->num_nodes = 0;
+    // The root stands for the empty prefix
+    new_node(index, '\0');
+    index->lines_indexed = 0;
+    return index;
+}
+
+void history_index_add(history_index_t *index, unsigned int seq, const char *line, size_t len) {
+    // Append seq to the posting list of every trigram of the line
+    for (size_t i = 0; i + 3 <= len; i++) {
+        unsigned int trigram = trigram_at(line + i);
+        int bucket = posting_bucket(index, trigram);
+        posting_list_t *list = &index->postings[bucket];
+        if (list->trigram == 0) {
+            // Keep the hash table at most half full
+            if (2 * (index->num_postings + 1) > index->postings_size) {
+                grow_postings(index);
+                bucket = posting_bucket(index, trigram);
+                list = &index->postings[bucket];
+            }
+            list->trigram = trigram;
+            list->seqs = NULL;
+            list->len = 0;
+            list->size = 0;
+            index->num_postings++;
+        }
+        // A trigram repeated in the same line is only recorded once
+        if (list->len > 0 && list->seqs[list->len - 1] == seq) {
+            continue;
+        }
+        if (list->len == list->size) {
+            list->size = list->size == 0 ? 4 : list->size * 2;
+            list->seqs = realloc(list->seqs, list->size * sizeof(unsigned int));
+        }
+        list->seqs[list->len++] = seq;
+    }
+    // Walk down the trie along the leading characters, every node on the way now
+    // has this line as its most recent one since lines are added in order
+    int node = 0;
+    index->nodes[0].max_seq = seq;
+    for (size_t i = 0; i < len && i < HISTORY_TRIE_DEPTH; i++) {
+        unsigned char c = line[i];
+        int child = find_child(index, node, c);
+        if (child == -1) {
+            child = new_node(index, c);
+            index->nodes[child].sibling = index->nodes[node].child;
+            index->nodes[node].child = child;
+        }
+        node = child;
+        index->nodes[node].max_seq = seq;
+    }
+    index->lines_indexed++;
+}
+
+unsigned int history_index_prefix(history_index_t *index, const char *prefix, size_t len) {
+    int node = 0;
+    for (size_t i = 0; i < len && i < HISTORY_TRIE_DEPTH; i++) {
+        node = find_child(index, node, prefix[i]);
+        if (node == -1) {
+            return 0;
+        }
+    }
+    return index->nodes[node].max_seq;
+}
+
+int history_index_candidates(history_index_t *index, const char *pattern, size_t len, const unsigned int **seqs) {
+    if (len < 3) {
+        *seqs = NULL;
+        return -1;
+    }
+    // Every match contains all trigrams of the pattern, so the shortest posting list is enough
+    posting_list_t *shortest = NULL;
+    for (size_t i = 0; i + 3 <= len; i++) {
+        posting_list_t *list = &index->postings[posting_bucket(index, trigram_at(pattern + i))];
+        if (list->trigram == 0) {
+            *seqs = NULL;
+            return 0;
+        }
+        if (shortest == NULL || list->len < shortest->len) {
+            shortest = list;
+        }
+    }
+    *seqs = shortest->seqs;
+    return shortest->len;
+}
+
+void free_history_index(history_index_t *index) {
+    for (int i = 0; i < index->postings_size; i++) {
+        free(index->postings[i].seqs);
+    }
+    free(index->postings);
+    free(index->nodes);
+    free(index);
+}
@@ -0,0 +1,58 @@
+#include "input.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+input_t *alloc_input(int fd) {
+    input_t *input = malloc(sizeof(input_t));
+    input->fd = fd;
+    input->size = 8192;
+    input->buf = malloc(input->size);
+    input->start = 0;
+    input->len = 0;
+    input->eof = false;
+    return input;
+}
+
+ssize_t input_read(input_t *input) {
+    // Drop the lines that were handed out, only a partial line is kept
+    if (input->start > 0) {
+        input->len -= input->start;
+        memmove(input->buf, input->buf + input->start, input->len);
+        input->start = 0;
+    }
+    // Make sure the buffer has room for a read and the terminating null character
+    if (input->size - input->len < 4096) {
+        input->size *= 2;
+        input->buf = realloc(input->buf, input->size);
+    }
+    ssize_t nread = read(input->fd, input->buf + input->len, input->size - input->len - 1);
+    if (nread == 0) {
+        input->eof = true;
+    } else if (nread > 0) {
+        input->len += nread;
+    }
+    return nread;
+}
+
+char *input_next_line(input_t *input) {
+    char *line = input->buf + input->start;
+    char *newline = memchr(line, '\n', input->len - input->start);
+    if (newline != NULL) {
+        *newline = '\0';
+        input->start = newline + 1 - input->buf;
+        return line;
+    }
+    // At the end of the file, the rest of the buffer is the last line
+    if (input->eof && input->start < input->len) {
+        input->buf[input->len] = '\0';
+        input->start = input->len;
+        return line;
+    }
+    return NULL;
+}
+
+void free_input(input_t *input) {
+    free(input->buf);
+    free(input);
+}
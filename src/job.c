@@ -1,95 +1,512 @@
 #include "job.h"
+#include "arena.h"
+#include <stddef.h>
+#include <signal.h>
 
-bool add_job(job_t *jobs, int max_jobs, pid_t pid, job_state_t state, const char *cmd_line) {
-    for (int i = 0; i < max_jobs; i++) {
-        // If found an empty position in the jobs array, add the job to the array
-        // pid = 0 indicates an empty position
-        if (jobs[i].pid == 0) {
-            jobs[i].pid = pid;
-            jobs[i].state = state;
-            // Allocate memory for cmd_line and copy the string
-            // strdup is basically a combination of malloc and strcpy
-            // Must be freed later
-            jobs[i].cmd_line = strdup(cmd_line);
-            jobs[i].jid = i + 1;
-            return true;
+static job_table_t *table_of(job_t *jobs) {
+    // The jobs array is the last member of its job_table_t
+    return (job_table_t *)((char *)jobs - offsetof(job_table_t, jobs));
+}
+
+static int index_bucket(job_table_t *table, pid_t pid) {
+    // Fibonacci hashing spreads consecutive pids over the buckets
+    return (int)(((unsigned int)pid * 2654435761u) & (unsigned int)(table->index_size - 1));
+}
+
+static int find_bucket(job_table_t *table, pid_t pid) {
+    // Linear probing, stops at the bucket holding pid or at the first empty bucket
+    int bucket = index_bucket(table, pid);
+    while (table->index_pids[bucket] != 0 && table->index_pids[bucket] != pid) {
+        bucket = (bucket + 1) & (table->index_size - 1);
+    }
+    return bucket;
+}
+
+static int find_slot(job_table_t *table, pid_t pid) {
+    if (pid <= 0) {
+        return -1;
+    }
+    int bucket = find_bucket(table, pid);
+    return table->index_pids[bucket] == pid ? table->index_slots[bucket] : -1;
+}
+
+static void index_remove(job_table_t *table, int bucket) {
+    // Backward shift deletion: move later entries of the probe sequence into the hole
+    // so no tombstones are needed and lookups never scan more than the cluster
+    int mask = table->index_size - 1;
+    int hole = bucket;
+    int next = (hole + 1) & mask;
+    while (table->index_pids[next] != 0) {
+        int home = index_bucket(table, table->index_pids[next]);
+        // Move the entry if its home bucket is not between the hole and its position
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            table->index_pids[hole] = table->index_pids[next];
+            table->index_slots[hole] = table->index_slots[next];
+            hole = next;
         }
+        next = (next + 1) & mask;
     }
-    return false;
+    table->index_pids[hole] = 0;
+    table->index_count--;
 }
 
-bool change_job_state(job_t *jobs, int max_jobs, pid_t pid, job_state_t state) {
+static void index_insert(job_table_t *table, pid_t pid, int slot) {
+    int bucket = find_bucket(table, pid);
+    table->index_pids[bucket] = pid;
+    table->index_slots[bucket] = slot;
+    table->index_count++;
+}
+
+static void rebuild_index(job_table_t *table, int index_size) {
+    // Index every job and every running pipeline stage again in a larger index
+    free(table->index_pids);
+    free(table->index_slots);
+    table->index_size = index_size;
+    table->index_pids = calloc(index_size, sizeof(pid_t));
+    table->index_slots = malloc(index_size * sizeof(int));
+    table->index_count = 0;
+    for (int i = table->first_used; i != -1; i = table->next_used[i]) {
+        index_insert(table, table->jobs[i].pid, i);
+        for (int s = 1; table->jobs[i].stages != NULL && s < table->jobs[i].num_stages; s++) {
+            if (!table->jobs[i].stages[s].done) {
+                index_insert(table, table->jobs[i].stages[s].pid, i);
+            }
+        }
+    }
+}
+
+static void index_add(job_table_t *table, pid_t pid, int slot) {
+    // Pipelines index more pids than there are slots, grow the index so it stays at most half full
+    if (2 * (table->index_count + 1) > table->index_size) {
+        rebuild_index(table, 2 * table->index_size);
+    }
+    index_insert(table, pid, slot);
+}
+
+job_t *alloc_jobs(int max_jobs) {
+    job_table_t *table = malloc(sizeof(job_table_t) + max_jobs * sizeof(job_t));
+    table->max_jobs = max_jobs;
+    // Push the slots in reverse so the first job gets slot 0 (i.e. job id 1)
+    table->free_slots = malloc(max_jobs * sizeof(int));
+    for (int i = 0; i < max_jobs; i++) {
+        table->free_slots[i] = max_jobs - 1 - i;
+    }
+    table->num_free = max_jobs;
+    // Keep the index at most half full
+    table->index_size = 16;
+    while (table->index_size < 2 * max_jobs) {
+        table->index_size *= 2;
+    }
+    table->index_pids = calloc(table->index_size, sizeof(pid_t));
+    table->index_slots = malloc(table->index_size * sizeof(int));
+    table->index_count = 0;
+    table->next_used = malloc(max_jobs * sizeof(int));
+    table->prev_used = malloc(max_jobs * sizeof(int));
+    table->first_used = -1;
+    table->last_used = -1;
+    table->cmd_bufs = calloc(max_jobs, sizeof(char *));
+    table->cmd_sizes = calloc(max_jobs, sizeof(size_t));
+    table->stage_bufs = calloc(max_jobs, sizeof(job_stage_t *));
+    table->stage_sizes = calloc(max_jobs, sizeof(int));
     for (int i = 0; i < max_jobs; i++) {
-        // If found the job with the pid, change the state of the job
-        if (jobs[i].pid == pid) {
-            // Change the state of the job
-            jobs[i].state = state;
-            return true;
+        table->jobs[i].cmd_line = NULL;
+        table->jobs[i].state = UNDEFINED;
+        table->jobs[i].pid = 0;
+        table->jobs[i].jid = 0;
+        table->jobs[i].pidfd = -1;
+        table->jobs[i].stages = NULL;
+        table->jobs[i].capture = NULL;
+        table->jobs[i].timeout_timer = -1;
+    }
+    return table->jobs;
+}
+
+job_t *grow_jobs(job_t *jobs, int max_jobs) {
+    job_table_t *table = table_of(jobs);
+    int old_max = table->max_jobs;
+    table = realloc(table, sizeof(job_table_t) + max_jobs * sizeof(job_t));
+    table->max_jobs = max_jobs;
+    table->free_slots = realloc(table->free_slots, max_jobs * sizeof(int));
+    table->next_used = realloc(table->next_used, max_jobs * sizeof(int));
+    table->prev_used = realloc(table->prev_used, max_jobs * sizeof(int));
+    table->cmd_bufs = realloc(table->cmd_bufs, max_jobs * sizeof(char *));
+    table->cmd_sizes = realloc(table->cmd_sizes, max_jobs * sizeof(size_t));
+    table->stage_bufs = realloc(table->stage_bufs, max_jobs * sizeof(job_stage_t *));
+    table->stage_sizes = realloc(table->stage_sizes, max_jobs * sizeof(int));
+    // Push the new slots in reverse so they are handed out in job id order
+    for (int i = max_jobs - 1; i >= old_max; i--) {
+        table->jobs[i].cmd_line = NULL;
+        table->jobs[i].state = UNDEFINED;
+        table->jobs[i].pid = 0;
+        table->jobs[i].jid = 0;
+        table->jobs[i].pidfd = -1;
+        table->jobs[i].stages = NULL;
+        table->jobs[i].capture = NULL;
+        table->jobs[i].timeout_timer = -1;
+        table->cmd_bufs[i] = NULL;
+        table->cmd_sizes[i] = 0;
+        table->stage_bufs[i] = NULL;
+        table->stage_sizes[i] = 0;
+        table->free_slots[table->num_free++] = i;
+    }
+    if (table->index_size < 2 * max_jobs) {
+        // Rebuild the pid index so it stays at most half full
+        int index_size = table->index_size;
+        while (index_size < 2 * max_jobs) {
+            index_size *= 2;
         }
+        rebuild_index(table, index_size);
+    }
+    return table->jobs;
+}
+
+bool jobs_full(job_t *jobs, int max_jobs) {
+    return table_of(jobs)->num_free == 0;
+}
+
+bool add_job(job_t *jobs, int max_jobs, pid_t pid, job_state_t state, const char *cmd_line) {
+    job_table_t *table = table_of(jobs);
+    // If there is no empty position in the jobs array, the job cannot be added
+    if (table->num_free == 0) {
+        return false;
+    }
+    int i = table->free_slots[--table->num_free];
+    jobs[i].pid = pid;
+    jobs[i].state = state;
+    // Copy cmd_line into the buffer of the slot, which only grows when a longer command used the slot
+    size_t len = strlen(cmd_line) + 1;
+    if (len > table->cmd_sizes[i]) {
+        free(table->cmd_bufs[i]);
+        table->cmd_sizes[i] = len < 64 ? 64 : len;
+        table->cmd_bufs[i] = malloc(table->cmd_sizes[i]);
+        alloc_stats.pool_mallocs++;
+    }
+    memcpy(table->cmd_bufs[i], cmd_line, len);
+    jobs[i].cmd_line = table->cmd_bufs[i];
+    jobs[i].jid = i + 1;
+    jobs[i].pidfd = -1;
+    jobs[i].stages = NULL;
+    jobs[i].num_stages = 1;
+    jobs[i].live_stages = 1;
+    jobs[i].stopped = false;
+    // The wall clock time of the job runs from here until its last process is reaped
+    jobs[i].timed = false;
+    jobs[i].capture = NULL;
+    jobs[i].timeout_timer = -1;
+    jobs[i].timeout_signal = 0;
+    memset(&jobs[i].usage, 0, sizeof(job_usage_t));
+    clock_gettime(CLOCK_MONOTONIC, &jobs[i].usage.started);
+    // Index the job by its pid
+    index_add(table, pid, i);
+    // Append the slot to the list of occupied slots
+    table->next_used[i] = -1;
+    table->prev_used[i] = table->last_used;
+    if (table->last_used == -1) {
+        table->first_used = i;
+    } else {
+        table->next_used[table->last_used] = i;
+    }
+    table->last_used = i;
+    return true;
+}
+
+bool change_job_state(job_t *jobs, int max_jobs, pid_t pid, job_state_t state) {
+    int i = find_slot(table_of(jobs), pid);
+    // If the job with the pid was not found, there is nothing to change
+    if (i == -1) {
+        return false;
     }
-    return false;
+    // Change the state of the job
+    jobs[i].state = state;
+    return true;
 }
 
 bool delete_job(job_t *jobs, int max_jobs, pid_t pid) {
-    for (int i = 0; i < max_jobs; i++) {
-        // If found the job with the pid, delete the job
-        if (jobs[i].pid == pid) {
-            jobs[i].pid = 0;
-            jobs[i].state = UNDEFINED;
-            // Free the job immediately in the jobs array
-            free(jobs[i].cmd_line);
-            // Set cmd_line to NULL to prevent freeing of cmd_line 
-            jobs[i].cmd_line = NULL;
-            jobs[i].jid = 0;
-            return true;
+    job_table_t *table = table_of(jobs);
+    if (pid <= 0) {
+        return false;
+    }
+    int bucket = find_bucket(table, pid);
+    // If the job with the pid was not found, there is nothing to delete
+    if (table->index_pids[bucket] != pid) {
+        return false;
+    }
+    int i = table->index_slots[bucket];
+    index_remove(table, bucket);
+    // The stages of a pipeline that are still indexed by their own pids
+    for (int s = 1; jobs[i].stages != NULL && s < jobs[i].num_stages; s++) {
+        if (!jobs[i].stages[s].done) {
+            index_remove(table, find_bucket(table, jobs[i].stages[s].pid));
         }
     }
-    return false;
+    // Unlink the slot from the list of occupied slots
+    if (table->prev_used[i] == -1) {
+        table->first_used = table->next_used[i];
+    } else {
+        table->next_used[table->prev_used[i]] = table->next_used[i];
+    }
+    if (table->next_used[i] == -1) {
+        table->last_used = table->prev_used[i];
+    } else {
+        table->prev_used[table->next_used[i]] = table->prev_used[i];
+    }
+    jobs[i].pid = 0;
+    jobs[i].state = UNDEFINED;
+    // The command line buffer stays with the slot for the next job
+    jobs[i].cmd_line = NULL;
+    jobs[i].jid = 0;
+    jobs[i].pidfd = -1;
+    jobs[i].stages = NULL;
+    // The slot is reused by the next job added
+    table->free_slots[table->num_free++] = i;
+    return true;
 }
 
-void free_jobs(job_t *jobs, int max_jobs) {
-    // Loop through jobs and free cmd_line for each job
-    for (int i = 0; i < max_jobs; i++) {
-        // If the job is not empty, free the cmd_line
-        // Prevents freeing of empty jobs by checking if pid is 0
-        if (jobs[i].pid != 0 && jobs[i].cmd_line != NULL) {
-            free(jobs[i].cmd_line);
-            jobs[i].cmd_line = NULL;
+bool add_stage(job_t *jobs, int max_jobs, pid_t pid, pid_t stage_pid) {
+    job_table_t *table = table_of(jobs);
+    int i = find_slot(table, pid);
+    if (i == -1) {
+        return false;
+    }
+    job_t *job = &jobs[i];
+    // Grow the stages buffer of the slot, it is kept for the next pipeline using the slot
+    int needed = job->stages == NULL ? 2 : job->num_stages + 1;
+    if (needed > table->stage_sizes[i]) {
+        table->stage_sizes[i] = table->stage_sizes[i] < 4 ? 4 : 2 * table->stage_sizes[i];
+        table->stage_bufs[i] = realloc(table->stage_bufs[i], table->stage_sizes[i] * sizeof(job_stage_t));
+        alloc_stats.pool_mallocs++;
+        if (job->stages != NULL) {
+            job->stages = table->stage_bufs[i];
+        }
+    }
+    if (job->stages == NULL) {
+        // The job becomes a pipeline, the process group leader is its first stage
+        job->stages = table->stage_bufs[i];
+        job->stages[0] = (job_stage_t){pid, job->pidfd, false};
+        job->num_stages = 1;
+        job->live_stages = 1;
+        job->pidfd = -1;
+    }
+    job->stages[job->num_stages++] = (job_stage_t){stage_pid, -1, false};
+    job->live_stages++;
+    // Index the stage by its pid, it finds the same slot as the job
+    index_add(table, stage_pid, i);
+    return true;
+}
+
+job_stage_t *find_stage(job_t *job, pid_t pid) {
+    for (int s = 0; job->stages != NULL && s < job->num_stages; s++) {
+        if (job->stages[s].pid == pid) {
+            return &job->stages[s];
         }
     }
-    // Lastly, deallocate jobs array
-    free(jobs);
+    return NULL;
+}
+
+int end_stage(job_t *jobs, int max_jobs, pid_t pid) {
+    job_table_t *table = table_of(jobs);
+    int i = find_slot(table, pid);
+    if (i == -1) {
+        return 0;
+    }
+    job_stage_t *stage = find_stage(&jobs[i], pid);
+    if (stage == NULL) {
+        return 0;
+    }
+    if (!stage->done) {
+        stage->done = true;
+        jobs[i].live_stages--;
+        // The process group leader keeps finding the job, its pid stays reserved while the group exists
+        if (pid != jobs[i].pid) {
+            index_remove(table, find_bucket(table, pid));
+        }
+    }
+    return jobs[i].live_stages;
+}
+
+static double timeval_ms(struct timeval tv) {
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+static double elapsed_ms(const struct timespec *since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1000.0 + (now.tv_nsec - since->tv_nsec) / 1e6;
+}
+
+void add_usage(job_t *job, const struct rusage *usage) {
+    if (usage == NULL) {
+        return;
+    }
+    // CPU time and context switches add up over the stages, the memory of the largest stage is kept
+    job->usage.user_ms += timeval_ms(usage->ru_utime);
+    job->usage.sys_ms += timeval_ms(usage->ru_stime);
+    if (usage->ru_maxrss > job->usage.max_rss_kb) {
+        job->usage.max_rss_kb = usage->ru_maxrss;
+    }
+    job->usage.voluntary_switches += usage->ru_nvcsw;
+    job->usage.involuntary_switches += usage->ru_nivcsw;
+}
+
+void finish_usage(job_t *job) {
+    job->usage.wall_ms = elapsed_ms(&job->usage.started);
+}
+
+void print_usage(FILE *out, const job_usage_t *usage) {
+    double wall_ms = usage->wall_ms > 0 ? usage->wall_ms : elapsed_ms(&usage->started);
+    fprintf(out, "real %.3fs user %.3fs sys %.3fs maxrss %ldKB ctxsw %ld/%ld\n", wall_ms / 1000,
+        usage->user_ms / 1000, usage->sys_ms / 1000, usage->max_rss_kb,
+        usage->voluntary_switches, usage->involuntary_switches);
+}
+
+void free_jobs(job_t *jobs, int max_jobs) {
+    job_table_t *table = table_of(jobs);
+    // Loop through the slots and free the command line buffer of each one
+    for (int i = 0; i < table->max_jobs; i++) {
+        free(table->cmd_bufs[i]);
+        jobs[i].cmd_line = NULL;
+    }
+    free(table->cmd_bufs);
+    free(table->cmd_sizes);
+    for (int i = 0; i < table->max_jobs; i++) {
+        free(table->stage_bufs[i]);
+    }
+    free(table->stage_bufs);
+    free(table->stage_sizes);
+    // Lastly, deallocate the bookkeeping and the jobs array
+    free(table->free_slots);
+    free(table->index_pids);
+    free(table->index_slots);
+    free(table->next_used);
+    free(table->prev_used);
+    free(table);
 }
 
 void print_jobs(job_t *jobs, int max_jobs) {
-    // Loop through jobs and print the jobs
-    for (int i = 0; i < max_jobs; i++) {
-        // If the job is not empty, print the job
-        // Prevents printing of empty jobs by checking if pid is 0
-        if (jobs[i].pid != 0) {
-            char *state;
-            state = jobs[i].state == SUSPENDED ? "Stopped" : "RUNNING";
-            printf("[%d] %d %s \t %s\n", jobs[i].jid, jobs[i].pid, state, jobs[i].cmd_line);
+    job_table_t *table = table_of(jobs);
+    // Loop through the occupied slots only, in the order the jobs were added
+    for (int i = table->first_used; i != -1; i = table->next_used[i]) {
+        char *state;
+        state = jobs[i].state == SUSPENDED ? "Stopped" : "RUNNING";
+        printf("[%d] %d %s \t %s\n", jobs[i].jid, jobs[i].pid, state, jobs[i].cmd_line);
+    }
+}
+
+void print_jobs_long(job_t *jobs, int max_jobs) {
+    job_table_t *table = table_of(jobs);
+    for (int i = table->first_used; i != -1; i = table->next_used[i]) {
+        char *state;
+        state = jobs[i].state == SUSPENDED ? "Stopped" : "RUNNING";
+        printf("[%d] %d %s \t %s\n", jobs[i].jid, jobs[i].pid, state, jobs[i].cmd_line);
+        // The CPU time and memory only include the stages that were reaped already
+        printf("    ");
+        print_usage(stdout, &jobs[i].usage);
+        if (jobs[i].timeout_signal != 0) {
+            printf("    deadline passed, sent %s\n", jobs[i].timeout_signal == SIGKILL ? "SIGKILL" : "SIGTERM");
+        }
+        for (int s = 0; jobs[i].stages != NULL && s < jobs[i].num_stages; s++) {
+            printf("    %d %s\n", jobs[i].stages[s].pid, jobs[i].stages[s].done ? "Done" : state);
         }
     }
 }
 
 pid_t get_job_pid(job_t *jobs, int max_jobs, int jid) {
-    for (int i = 0; i < max_jobs; i++) {
-        // If found the job with the jid, return the pid of the job
-        if (jobs[i].jid == jid) {
-            return jobs[i].pid;
-        }
+    job_table_t *table = table_of(jobs);
+    // The job id is the slot number plus one
+    if (jid < 1 || jid > table->max_jobs || jobs[jid - 1].pid == 0) {
+        return -1;
     }
-    return -1;
+    return jobs[jid - 1].pid;
 }
 
 int get_job_jid(job_t *jobs, int max_jobs, pid_t pid) {
-    for (int i = 0; i < max_jobs; i++) {
-        // If found the job with the pid, return the jid of the job
-        if (jobs[i].pid == pid) {
-            return jobs[i].jid;
-        }
+    int i = find_slot(table_of(jobs), pid);
+    // If found the job with the pid, return the jid of the job
+    if (i == -1) {
+        return -1;
+    }
+    return jobs[i].jid;
+}
+
+job_t *find_job(job_t *jobs, int max_jobs, pid_t pid) {
+    int i = find_slot(table_of(jobs), pid);
+    return i == -1 ? NULL : &jobs[i];
+}
+
+job_queue_t *alloc_job_queue(void) {
+    job_queue_t *queue = malloc(sizeof(job_queue_t));
+    queue->head = NULL;
+    queue->tail = NULL;
+    queue->count = 0;
+    return queue;
+}
+
+void enqueue_job(job_queue_t *queue, const char *path, char **argv, const char *cmd_line) {
+    // Copy argv and its strings into a single allocation, the command line
+    // they point into is gone by the time the job is launched
+    int argc = 0;
+    size_t strings_len = 0;
+    while (argv[argc] != NULL) {
+        strings_len += strlen(argv[argc]) + 1;
+        argc++;
+    }
+    char **argv_copy = malloc((argc + 1) * sizeof(char *) + strings_len);
+    char *strings = (char *)(argv_copy + argc + 1);
+    for (int i = 0; i < argc; i++) {
+        argv_copy[i] = strcpy(strings, argv[i]);
+        strings += strlen(argv[i]) + 1;
+    }
+    argv_copy[argc] = NULL;
+    queued_job_t *job = malloc(sizeof(queued_job_t));
+    job->path = strdup(path);
+    job->argv = argv_copy;
+    job->cmd_line = strdup(cmd_line);
+    job->capture = false;
+    job->timeout_ms = 0;
+    job->next = NULL;
+    // Append the job to the back of the queue
+    if (queue->tail == NULL) {
+        queue->head = job;
+    } else {
+        queue->tail->next = job;
     }
-    return -1;
-}
\ No newline at end of file
+    queue->tail = job;
+    queue->count++;
+}
+
+queued_job_t *dequeue_job(job_queue_t *queue) {
+    queued_job_t *job = queue->head;
+    if (job == NULL) {
+        return NULL;
+    }
+    queue->head = job->next;
+    if (queue->head == NULL) {
+        queue->tail = NULL;
+    }
+    queue->count--;
+    job->next = NULL;
+    return job;
+}
+
+void free_queued_job(queued_job_t *job) {
+    free(job->path);
+    free(job->argv);
+    free(job->cmd_line);
+    free(job);
+}
+
+void print_job_queue(job_queue_t *queue) {
+    int position = 1;
+    for (queued_job_t *job = queue->head; job != NULL; job = job->next) {
+        printf("[+%d] %s \t %s\n", position, "Queued", job->cmd_line);
+        position++;
+    }
+}
+
+void free_job_queue(job_queue_t *queue) {
+    queued_job_t *job;
+    while ((job = dequeue_job(queue)) != NULL) {
+        free_queued_job(job);
+    }
+    free(queue);
+}
@@ -0,0 +1,85 @@
+#include "launch.h"
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "csapp.h"
+
+extern char **environ;
+
+int parse_launch_mode(const char *name, launch_mode_t *mode) {
+    if (strcmp(name, "spawn") == 0) {
+        *mode = LAUNCH_SPAWN;
+        return 0;
+    } else if (strcmp(name, "fork") == 0) {
+        *mode = LAUNCH_FORK;
+        return 0;
+    }
+    return 1;
+}
+
+static pid_t spawn_process(const char *path, char **argv, const sigset_t *child_mask, pid_t pgid, const int *fds) {
+    // posix_spawn shares the address space with the child until it calls execve,
+    // so no page tables are copied no matter how large the shell is
+    posix_spawnattr_t attr;
+    posix_spawn_file_actions_t actions;
+    pid_t pid;
+    posix_spawnattr_init(&attr);
+    // Put the child in a new process group whose group ID is identical to the child's PID (or in pgid)
+    // and restore the signal mask the shell had before blocking SIGCHLD
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK);
+    posix_spawnattr_setpgroup(&attr, pgid);
+    posix_spawnattr_setsigmask(&attr, child_mask);
+    // Connect the pipes of a pipeline stage
+    posix_spawn_file_actions_init(&actions);
+    for (int i = 0; fds != NULL && i < 3; i++) {
+        if (fds[i] != -1) {
+            posix_spawn_file_actions_adddup2(&actions, fds[i], i);
+        }
+    }
+    int err = posix_spawn(&pid, path, &actions, &attr, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    if (err != 0) {
+        // The exec failure is reported back to the parent, so no child is left behind
+        printf("%s: Command not found.\n", argv[0]);
+        return -1;
+    }
+    return pid;
+}
+
+static pid_t fork_process(const char *path, char **argv, const sigset_t *child_mask, pid_t pgid, const int *fds) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        // Unblock child process
+        Sigprocmask(SIG_SETMASK, child_mask, NULL);
+        // Put the child in a new process group whose group ID is identical to the child’s PID (or in pgid)
+        Setpgid(0, pgid);
+        // Connect the pipes of a pipeline stage
+        for (int i = 0; fds != NULL && i < 3; i++) {
+            if (fds[i] != -1) {
+                dup2(fds[i], i);
+            }
+        }
+        // Child executes the command
+        if (execve(path, argv, environ) < 0) {
+            printf("%s: Command not found.\n", argv[0]);
+            exit(1);
+        }
+    } else if (pid < 0) {
+        perror("fork error");
+    } else {
+        // Also set the process group from the parent, so the group exists before the first stage can be
+        // reaped, whichever of the two runs first. It fails harmlessly once the child called execve
+        setpgid(pid, pgid == 0 ? pid : pgid);
+    }
+    return pid;
+}
+
+pid_t launch_process(launch_mode_t mode, const char *path, char **argv, const sigset_t *child_mask, pid_t pgid, const int *fds) {
+    if (mode == LAUNCH_FORK) {
+        return fork_process(path, argv, child_mask, pgid, fds);
+    }
+    return spawn_process(path, argv, child_mask, pgid, fds);
+}
@@ -1,9 +1,20 @@
 #define _GNU_SOURCE
 #include "shell.h"
-#include "common.c"
+#include <fcntl.h>
+
+// Defined in common.c, which the tests and benchmarks link as well
+extern msh_t *shell;
 
 int parse_option(char opt, char* optarg, int* option);
-int optional_args(int* argc, char* argv[], int* s, int* j, int* l);
+int optional_args(int* argc, char* argv[], int* s, int* j, int* l, int* J, launch_mode_t* x, bool* Z, char** c, char** script);
+void read_input(int fd, void *data);
+int evaluate_string(msh_t *shell, const char *commands);
+
+// Copy of the line being evaluated, evaluate may read more input while it runs (i.e. parallel reading stdin)
+static char *line = NULL;
+static size_t line_size = 0;
+// Set once stdin reaches end of file or evaluate asks the shell to exit
+static bool input_done = false;
 
 
 int main(int argc, char *argv[]) {
@@ -11,7 +22,7 @@ int main(int argc, char *argv[]) {
     The main function performs a few tasks:
     1. Parse the optional arguments
     2. Initialize the shell and allocate memory
-    3. Read input from stdin until the user exits or a file
+    3. Read input from stdin, the script file or the -c argument until the user exits or the input ends
     4. Evaluate the input
     5. Free the shell memory
 
@@ -23,40 +34,138 @@ int main(int argc, char *argv[]) {
     */
     
     // Parse optional arguments
-    int s = 0, j = 0, l = 0, op_status = 0;
-    op_status = optional_args(&argc, argv, &s, &j, &l);
+    int s = 0, j = 0, l = 0, J = 0, op_status = 0;
+    launch_mode_t x = LAUNCH_SPAWN;
+    bool Z = false;
+    char *c = NULL, *script = NULL;
+    op_status = optional_args(&argc, argv, &s, &j, &l, &J, &x, &Z, &c, &script);
     if (op_status == 1) {
         // If optional arguments are not valid, print usage requirements and exit
-        printf("usage: msh [-s NUMBER] [-j NUMBER] [-l NUMBER]\n"); 
+        printf("usage: msh [-s NUMBER] [-j NUMBER] [-l NUMBER] [-J NUMBER] [-X spawn|fork] [-Z] [-c COMMANDS | SCRIPT]\n"); 
         return 1;
     }
+    // The script is read like stdin would be, the commands it runs keep the stdin of the shell
+    int input_fd = STDIN_FILENO;
+    if (script != NULL && (input_fd = open(script, O_RDONLY | O_CLOEXEC)) < 0) {
+        fprintf(stderr, "msh: %s: %s\n", script, strerror(errno));
+        return 127;
+    }
 
     // Initialize the shell and allocate memory
-    shell = alloc_shell(j, l, s);
-
-    char *line = NULL;
-    size_t len = 0;
-    long read;
-    printf("msh> ");
-    while ((read = getline(&line, &len, stdin)) != -1) {
-        // Remove newline character
-        line[strcspn(line, "\n")] = 0;  
-        // If evaluate returns 1, there is an issue. Break and exit
-        if (evaluate(shell, line) == 1) {
-            free(line);
-            line = NULL;
-            break;
+    shell = alloc_shell(j, l, s, Z);
+    // Without -J the number given to -j stays a hard limit, as it was before the jobs array could grow
+    shell->max_jobs_limit = J == 0 ? j : J;
+    shell->launch_mode = x;
+    if (c != NULL || script != NULL) {
+        shell->interactive = false;
+    }
+    if (!shell->interactive) {
+        // Nobody reads the output as it is written, it is flushed before every child is launched and at exit
+        setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+    }
+
+    if (c != NULL) {
+        // The commands given with -c are evaluated without reading any input
+        evaluate_string(shell, c);
+    } else {
+        // Read commands through the event loop, which also reaps children and runs timers
+        shell->input = alloc_input(input_fd);
+        if (shell->interactive) {
+            printf("msh> ");
+        }
+        event_loop_add_fd(input_fd, read_input, shell);
+        while (!input_done) {
+            // The prompt has no newline, make sure it is shown before waiting
+            if (shell->interactive) {
+                fflush(stdout);
+            }
+            event_loop_run_once(-1);
+            // With set -b the jobs that changed state while the shell waited for input are reported right away
+            if (shell->notify && notifications_pending()) {
+                flush_notifications(shell->interactive, shell->interactive ? "msh> " : NULL);
+            }
         }
-        // Free the line and set it to NULL
-        free(line);
-        line = NULL;
-        printf("msh> ");
+        event_loop_remove_fd(input_fd);
     }
+    // Nothing is left waiting for a prompt that will not come
+    flush_notifications(shell->interactive, NULL);
+    if (script != NULL) {
+        close(input_fd);
+    }
+    free(line);
     // Free the shell memory
     exit_shell(shell);
     return 0;
 }
 
+void read_input(int fd, void *data) {
+    /*
+    Event handler that reads stdin and evaluates every complete line
+
+    Arguments:
+    fd: The file descriptor of stdin
+    data: The shell
+    */
+
+    msh_t *shell = data;
+    ssize_t nread = input_read(shell->input);
+    if (nread < 0) {
+        // Stop reading on errors other than an interrupted read
+        input_done = errno != EINTR && errno != EAGAIN;
+        return;
+    }
+    char *next;
+    while (!input_done && (next = input_next_line(shell->input)) != NULL) {
+        // Copy the line into the reused line buffer
+        size_t len = strlen(next);
+        if (len + 1 > line_size) {
+            line_size = len + 1 > 2 * line_size ? len + 1 : 2 * line_size;
+            line = realloc(line, line_size);
+        }
+        memcpy(line, next, len + 1);
+        // If evaluate returns 1, there is an issue. Stop reading and exit
+        if (evaluate(shell, line) == 1) {
+            input_done = true;
+            break;
+        }
+        // The pending job notifications come before the prompt, written together
+        flush_notifications(shell->interactive, shell->interactive ? "msh> " : NULL);
+    }
+    // Stop at the end of the file
+    if (shell->input->eof) {
+        input_done = true;
+    }
+}
+
+int evaluate_string(msh_t *shell, const char *commands) {
+    /*
+    Evaluate the lines of the argument of -c one after the other
+
+    Arguments:
+    shell: The shell
+    commands: The command lines, separated by newlines
+
+    Returns: 1 if a command line asked the shell to exit, 0 otherwise
+    */
+
+    while (*commands != '\0') {
+        // Copy the next line into the reused line buffer, evaluate modifies it
+        size_t len = strcspn(commands, "\n");
+        if (len + 1 > line_size) {
+            line_size = len + 1 > 2 * line_size ? len + 1 : 2 * line_size;
+            line = realloc(line, line_size);
+        }
+        memcpy(line, commands, len);
+        line[len] = '\0';
+        commands += len + (commands[len] == '\n');
+        if (evaluate(shell, line) == 1) {
+            return 1;
+        }
+        flush_notifications(false, NULL);
+    }
+    return 0;
+}
+
 int parse_option(char opt, char* optarg, int* option) {
     /*
     Helper function to parse optional arguments
@@ -87,7 +196,7 @@ int is_integer(const char *str) {
     return end != str && *end == '\0';
 }
 
-int optional_args(int* argc, char* argv[], int* s, int* j, int* l) {
+int optional_args(int* argc, char* argv[], int* s, int* j, int* l, int* J, launch_mode_t* x, bool* Z, char** c, char** script) {
     /*
     Function to parse optional arguments
 
@@ -95,24 +204,48 @@ int optional_args(int* argc, char* argv[], int* s, int* j, int* l) {
     argc: The number of arguments passed to the shell
     argv: The arguments passed to the shell.
     s: The maximum number of command lines to store in the shell history
-    j: The maximum number of jobs that can be in existence at any point in time
+    j: The number of jobs that can be in existence at any point in time, only the initial number if -J is given
+    J: The hard limit the number of jobs can grow to, background jobs past it (or past -j without -J) are queued
     l: The maximum number of characters that can be entered on a single command line
-    s, j and l are to be updated if the respective optional arguments are parsed
+    x: The launcher backend used to start external commands (spawn or fork)
+    Z: Whether external commands are launched through a zygote process
+    c: The command lines given with -c, evaluated instead of reading stdin
+    script: The script file given after the options, read instead of stdin. The arguments after it are ignored.
+    s, j, l, J, x, Z, c and script are to be updated if the respective optional arguments are parsed
     */
 
     int opt = 0;
     opterr = 0;
 
     for (int i = 1; i < *argc; i++) {
-        // Check if optional argument other than -l, -s, -j or their respective numbers are provided
-        if (strcmp(argv[i], "-l") != 0 && strcmp(argv[i], "-s") != 0 && strcmp(argv[i], "-j") != 0 && !is_integer(argv[i])) {
+        // Skip the launcher backend name given to -X, it is validated when parsed below, and the commands given to -c
+        if ((strcmp(argv[i], "-X") == 0 || strcmp(argv[i], "-c") == 0) && i + 1 < *argc) {
+            i++;
+            continue;
+        }
+        // The first argument that is not an option is the script, the options end there
+        if (argv[i][0] != '-' && !is_integer(argv[i])) {
+            break;
+        }
+        // Check if optional argument other than -l, -s, -j, -J, -X, -Z or their respective values are provided
+        if (strcmp(argv[i], "-l") != 0 && strcmp(argv[i], "-s") != 0 && strcmp(argv[i], "-j") != 0 && strcmp(argv[i], "-J") != 0 && strcmp(argv[i], "-Z") != 0 && !is_integer(argv[i])) {
             return 1;
         }
     }
 
-    // Parse optional arguments
-    while((opt = getopt(*argc, argv, "j:l:s:")) != -1)  
+    // Parse optional arguments, + stops at the script so the arguments of the script are not parsed
+    while((opt = getopt(*argc, argv, "+j:J:l:s:X:Zc:")) != -1)  
     {  
+        // -Z takes no value
+        if (opt == 'Z') {
+            *Z = true;
+            continue;
+        }
+        // The commands of -c may start with a dash
+        if (opt == 'c') {
+            *c = optarg;
+            continue;
+        }
         // Check if optional argument is provided but value is not provided
         if (optarg == NULL || optarg[0] == '-') {
             return 1;
@@ -124,6 +257,11 @@ int optional_args(int* argc, char* argv[], int* s, int* j, int* l) {
                     return 1;
                 }
                 break;
+            case 'J':
+                if (parse_option(opt, optarg, J)) {
+                    return 1;
+                }
+                break;
             case 'l': 
                 if (parse_option(opt, optarg, l)) {
                     return 1;
@@ -134,10 +272,22 @@ int optional_args(int* argc, char* argv[], int* s, int* j, int* l) {
                     return 1;
                 }
                 break;
+            case 'X':
+                if (parse_launch_mode(optarg, x)) {
+                    return 1;
+                }
+                break;
             case ':': // if optional command argument value is not provided
             case '?': // if optional command is not recognizable
                 return 1;
         }  
     }
+    // A script cannot be combined with -c
+    if (optind < *argc) {
+        if (*c != NULL) {
+            return 1;
+        }
+        *script = argv[optind];
+    }
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,54 @@
+#include "notify.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+// The notifications are only queued and written from the event loop, the indices wrap around the ring
+static notification_t ring[NOTIFY_RING_SIZE];
+static unsigned int head = 0;
+static unsigned int tail = 0;
+// Large enough for a full ring of "pid PID Timed out\n" lines
+static char text[NOTIFY_RING_SIZE * 32];
+
+static const char *event_names[] = {"Done", "Stopped", "Continue", "Timed out"};
+
+static size_t format_notifications(void) {
+    // Move the queued notifications out of the ring into text, returns the number of bytes
+    size_t len = 0;
+    while (tail != head) {
+        notification_t *notification = &ring[tail++ & (NOTIFY_RING_SIZE - 1)];
+        len += sprintf(text + len, "pid %d %s\n", notification->pid, event_names[notification->event]);
+    }
+    return len;
+}
+
+void notify_job(pid_t pid, job_event_t event) {
+    if (head - tail == NOTIFY_RING_SIZE) {
+        // The ring is full, the oldest notifications go to the stdout buffer so they stay in order
+        fwrite(text, 1, format_notifications(), stdout);
+    }
+    ring[head++ & (NOTIFY_RING_SIZE - 1)] = (notification_t){pid, event};
+}
+
+bool notifications_pending(void) {
+    return head != tail;
+}
+
+void flush_notifications(bool direct, const char *prompt) {
+    size_t len = format_notifications();
+    if (!direct) {
+        fwrite(text, 1, len, stdout);
+        if (prompt != NULL) {
+            fputs(prompt, stdout);
+        }
+        return;
+    }
+    // Whatever the shell printed before must come first
+    fflush(stdout);
+    struct iovec iov[2] = {
+        {text, len},
+        {(void *)prompt, prompt != NULL ? strlen(prompt) : 0},
+    };
+    writev(STDOUT_FILENO, iov, 2);
+}
@@ -0,0 +1,251 @@
+#define _GNU_SOURCE
+#include "path_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// PATH used when the variable is not set, same as the default of execvp
+static const char *DEFAULT_PATH = "/bin:/usr/bin";
+
+static unsigned int hash_name(const char *name) {
+    // FNV-1a hash of the command name
+    unsigned int hash = 2166136261u;
+    while (*name != '\0') {
+        hash ^= (unsigned char)*name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void free_entry(path_entry_t *entry) {
+    free(entry->name);
+    free(entry->path);
+    free(entry);
+}
+
+static const char *current_path_env(void) {
+    const char *path_env = getenv("PATH");
+    return path_env == NULL ? DEFAULT_PATH : path_env;
+}
+
+static void set_path_env(path_cache_t *cache, const char *path_env) {
+    // Split PATH into its directories, which are looked at again on every lookup
+    for (int i = 0; i < cache->num_dirs; i++) {
+        free(cache->dirs[i].name);
+    }
+    free(cache->dirs);
+    cache->path_env = strdup(path_env);
+    cache->num_dirs = 1;
+    for (const char *p = path_env; *p != '\0'; p++) {
+        cache->num_dirs += *p == ':';
+    }
+    cache->dirs = calloc(cache->num_dirs, sizeof(path_dir_t));
+    const char *start = path_env;
+    for (int i = 0; i < cache->num_dirs; i++) {
+        const char *end = strchrnul(start, ':');
+        // An empty PATH component means the current directory
+        cache->dirs[i].name = end == start ? strdup(".") : strndup(start, end - start);
+        start = end + 1;
+    }
+}
+
+path_cache_t *alloc_path_cache(void) {
+    path_cache_t *cache = malloc(sizeof(path_cache_t));
+    cache->num_buckets = 64;
+    cache->buckets = calloc(cache->num_buckets, sizeof(path_entry_t *));
+    cache->count = 0;
+    cache->dirs = NULL;
+    cache->num_dirs = 0;
+    cache->generation = 0;
+    set_path_env(cache, current_path_env());
+    return cache;
+}
+
+void path_cache_clear(path_cache_t *cache) {
+    for (int i = 0; i < cache->num_buckets; i++) {
+        path_entry_t *entry = cache->buckets[i];
+        while (entry != NULL) {
+            path_entry_t *next = entry->next;
+            free_entry(entry);
+            entry = next;
+        }
+        cache->buckets[i] = NULL;
+    }
+    cache->count = 0;
+}
+
+static void check_path_env(path_cache_t *cache) {
+    // Every entry was resolved against the old PATH, so forget them all if it changed
+    const char *path_env = current_path_env();
+    if (strcmp(path_env, cache->path_env) != 0) {
+        path_cache_clear(cache);
+        free(cache->path_env);
+        set_path_env(cache, path_env);
+    }
+}
+
+static void refresh_dir(path_cache_t *cache, int i) {
+    // Adding or removing a file in a directory changes its modification time, so does creating the directory
+    path_dir_t *dir = &cache->dirs[i];
+    struct stat st;
+    struct timespec mtime = {0, 0};
+    if (stat(dir->name, &st) == 0) {
+        mtime = st.st_mtim;
+    }
+    if (mtime.tv_sec != dir->mtime.tv_sec || mtime.tv_nsec != dir->mtime.tv_nsec) {
+        dir->mtime = mtime;
+        dir->changed = ++cache->generation;
+    }
+}
+
+static path_entry_t **find_link(path_cache_t *cache, const char *name) {
+    // Returns the link pointing at the entry for name, or at the NULL ending its bucket
+    path_entry_t **link = &cache->buckets[hash_name(name) & (cache->num_buckets - 1)];
+    while (*link != NULL && strcmp((*link)->name, name) != 0) {
+        link = &(*link)->next;
+    }
+    return link;
+}
+
+static void grow_buckets(path_cache_t *cache) {
+    // Double the number of buckets and move every entry to its new bucket
+    int num_buckets = cache->num_buckets * 2;
+    path_entry_t **buckets = calloc(num_buckets, sizeof(path_entry_t *));
+    for (int i = 0; i < cache->num_buckets; i++) {
+        path_entry_t *entry = cache->buckets[i];
+        while (entry != NULL) {
+            path_entry_t *next = entry->next;
+            unsigned int bucket = hash_name(entry->name) & (num_buckets - 1);
+            entry->next = buckets[bucket];
+            buckets[bucket] = entry;
+            entry = next;
+        }
+    }
+    free(cache->buckets);
+    cache->buckets = buckets;
+    cache->num_buckets = num_buckets;
+}
+
+static path_entry_t *insert_entry(path_cache_t *cache, const char *name, const char *path, int dir_index) {
+    path_entry_t **link = find_link(cache, name);
+    if (*link != NULL) {
+        // Replace the location of an existing entry
+        path_entry_t *old = *link;
+        *link = old->next;
+        free_entry(old);
+        cache->count--;
+    }
+    if (cache->count >= cache->num_buckets * 2) {
+        grow_buckets(cache);
+    }
+    path_entry_t *entry = malloc(sizeof(path_entry_t));
+    entry->name = strdup(name);
+    entry->path = strdup(path);
+    entry->dir_index = dir_index;
+    entry->generation = cache->generation;
+    entry->hits = 0;
+    unsigned int bucket = hash_name(name) & (cache->num_buckets - 1);
+    entry->next = cache->buckets[bucket];
+    cache->buckets[bucket] = entry;
+    cache->count++;
+    return entry;
+}
+
+static path_entry_t *resolve_entry(path_cache_t *cache, const char *name) {
+    // Walk the PATH directories in order and remember the first executable named name
+    char candidate[PATH_MAX];
+    for (int i = 0; i < cache->num_dirs; i++) {
+        // The directory is looked at before it is searched, so a command added to it later changes it again
+        refresh_dir(cache, i);
+        struct stat st;
+        if (snprintf(candidate, sizeof(candidate), "%s/%s", cache->dirs[i].name, name) < (int)sizeof(candidate)
+                && stat(candidate, &st) == 0 && S_ISREG(st.st_mode) && access(candidate, X_OK) == 0) {
+            return insert_entry(cache, name, candidate, i);
+        }
+    }
+    return NULL;
+}
+
+static bool entry_is_fresh(path_cache_t *cache, path_entry_t *entry) {
+    // A command added to an earlier directory takes precedence, one removed from its own directory is gone,
+    // so none of the directories up to the one the command was found in may have changed since
+    for (int i = 0; i <= entry->dir_index; i++) {
+        refresh_dir(cache, i);
+        if (cache->dirs[i].changed > entry->generation) {
+            return false;
+        }
+    }
+    // Entries set with hash -p (dir_index -1) are kept until hash -r
+    return true;
+}
+
+const char *path_cache_lookup(path_cache_t *cache, const char *name) {
+    // Names containing a slash are executed as given, without searching PATH
+    if (strchr(name, '/') != NULL) {
+        return name;
+    }
+    check_path_env(cache);
+    path_entry_t **link = find_link(cache, name);
+    path_entry_t *entry = *link;
+    if (entry != NULL && !entry_is_fresh(cache, entry)) {
+        // A directory changed since the command was resolved, search PATH again
+        *link = entry->next;
+        free_entry(entry);
+        cache->count--;
+        entry = NULL;
+    }
+    if (entry == NULL) {
+        entry = resolve_entry(cache, name);
+        if (entry == NULL) {
+            return NULL;
+        }
+    }
+    entry->hits++;
+    return entry->path;
+}
+
+bool path_cache_add(path_cache_t *cache, const char *name) {
+    if (strchr(name, '/') != NULL) {
+        return false;
+    }
+    check_path_env(cache);
+    return resolve_entry(cache, name) != NULL;
+}
+
+void path_cache_set(path_cache_t *cache, const char *name, const char *path) {
+    check_path_env(cache);
+    insert_entry(cache, name, path, -1);
+}
+
+void print_path_cache(path_cache_t *cache, bool reusable) {
+    if (cache->count == 0) {
+        printf("hash: hash table empty\n");
+        return;
+    }
+    if (!reusable) {
+        printf("hits\tcommand\n");
+    }
+    for (int i = 0; i < cache->num_buckets; i++) {
+        for (path_entry_t *entry = cache->buckets[i]; entry != NULL; entry = entry->next) {
+            if (reusable) {
+                printf("hash -p %s %s\n", entry->path, entry->name);
+            } else {
+                printf("%4d\t%s\n", entry->hits, entry->path);
+            }
+        }
+    }
+}
+
+void free_path_cache(path_cache_t *cache) {
+    path_cache_clear(cache);
+    free(cache->buckets);
+    free(cache->path_env);
+    for (int i = 0; i < cache->num_dirs; i++) {
+        free(cache->dirs[i].name);
+    }
+    free(cache->dirs);
+    free(cache);
+}
@@ -0,0 +1,72 @@
+#include "pressure.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// The files read by read_pressure, opened on the first call. -1 if the kernel does not have them.
+static const char *paths[] = {"/proc/pressure/cpu", "/proc/pressure/memory", "/proc/loadavg"};
+static int fds[3] = {-2, -2, -2};
+
+static bool read_file(int i, char *buf, size_t size) {
+    // Helper function to read one of the files from its start, NUL terminated
+    if (fds[i] == -2) {
+        fds[i] = open(paths[i], O_RDONLY | O_CLOEXEC);
+    }
+    if (fds[i] == -1) {
+        return false;
+    }
+    ssize_t n = pread(fds[i], buf, size - 1, 0);
+    if (n <= 0) {
+        return false;
+    }
+    buf[n] = '\0';
+    return true;
+}
+
+double parse_psi(const char *text) {
+    // The "some" line comes first, "full" follows it for memory
+    const char *line = strstr(text, "some ");
+    if (line == NULL || (line != text && line[-1] != '\n')) {
+        return -1;
+    }
+    const char *avg10 = strstr(line, "avg10=");
+    const char *end = strchr(line, '\n');
+    if (avg10 == NULL || (end != NULL && avg10 > end)) {
+        return -1;
+    }
+    return strtod(avg10 + 6, NULL);
+}
+
+void read_pressure(pressure_t *pressure) {
+    char buf[256];
+    pressure->cpu = read_file(0, buf, sizeof(buf)) ? parse_psi(buf) : -1;
+    pressure->memory = read_file(1, buf, sizeof(buf)) ? parse_psi(buf) : -1;
+    pressure->load = read_file(2, buf, sizeof(buf)) ? strtod(buf, NULL) : -1;
+}
+
+bool over_limits(const pressure_t *pressure, const pressure_limits_t *limits) {
+    return (limits->cpu > 0 && pressure->cpu > limits->cpu) ||
+        (limits->memory > 0 && pressure->memory > limits->memory) ||
+        (limits->load > 0 && pressure->load > limits->load);
+}
+
+static void print_reading(FILE *out, const char *name, double value, double limit, const char *unit) {
+    // Helper function to print one reading and its limit, unknown readings and unset limits as -
+    char text[32] = "-";
+    if (value >= 0) {
+        snprintf(text, sizeof(text), "%.2f%s", value, unit);
+    }
+    fprintf(out, "%-8s%10s", name, text);
+    if (limit > 0) {
+        fprintf(out, "  limit %.2f%s\n", limit, unit);
+    } else {
+        fprintf(out, "  limit -\n");
+    }
+}
+
+void print_pressure(FILE *out, const pressure_t *pressure, const pressure_limits_t *limits) {
+    print_reading(out, "cpu", pressure->cpu, limits->cpu, "%");
+    print_reading(out, "memory", pressure->memory, limits->memory, "%");
+    print_reading(out, "load", pressure->load, limits->load, "");
+}
@@ -0,0 +1,108 @@
+#define _GNU_SOURCE
+#include "relay.h"
+#include "event_loop.h"
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+// The most bytes moved by one splice call
+#define RELAY_CHUNK 65536
+
+// Represents the shell sitting between two stages of a pipeline
+typedef struct relay {
+    int in_fds[2];  // The stdout and stderr pipes of the writing stage, -1 once closed
+    int next_fd;    // The stdin pipe of the reading stage
+}relay_t;
+
+static void close_input(relay_t *relay, int i) {
+    // Helper function to stop relaying one input, the relay is freed with its last input
+    event_loop_remove_fd(relay->in_fds[i]);
+    close(relay->in_fds[i]);
+    relay->in_fds[i] = -1;
+    if (relay->in_fds[0] == -1 && relay->in_fds[1] == -1) {
+        // The next stage reads end of file
+        event_loop_remove_fd(relay->next_fd);
+        close(relay->next_fd);
+        free(relay);
+    }
+}
+
+static void relay_writable(int fd, void *data) {
+    // The next stage drained its pipe, resume reading the inputs
+    relay_t *relay = data;
+    event_loop_remove_fd(fd);
+    for (int i = 0; i < 2; i++) {
+        event_loop_pause_fd(relay->in_fds[i], false);
+    }
+}
+
+static void relay_pipe(relay_t *relay, int i) {
+    // Helper function to move everything input i has to the next stage, or until its pipe is full
+    int fd = relay->in_fds[i];
+    while (true) {
+        ssize_t n = splice(fd, NULL, relay->next_fd, NULL, RELAY_CHUNK, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n > 0) {
+            continue;
+        }
+        if (n == 0) {
+            // The stage closed its end of the pipe
+            close_input(relay, i);
+            return;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EAGAIN) {
+            // The next stage exited (EPIPE), the writing stage gets SIGPIPE once its pipes are closed.
+            // The relay is freed with the input closed last
+            if (relay->in_fds[1 - i] != -1) {
+                close_input(relay, 1 - i);
+            }
+            close_input(relay, i);
+            return;
+        }
+        // Either the input is empty or the pipe of the next stage is full
+        int pending = 0;
+        if (ioctl(fd, FIONREAD, &pending) == 0 && pending > 0) {
+            // Stop reading until the next stage made room
+            for (int j = 0; j < 2; j++) {
+                event_loop_pause_fd(relay->in_fds[j], true);
+            }
+            event_loop_add_writer(relay->next_fd, relay_writable, relay);
+        }
+        return;
+    }
+}
+
+static void relay_input(int fd, void *data) {
+    relay_t *relay = data;
+    // Writing to the pipe of a stage that exited raises SIGPIPE, which must not stop the shell
+    sigset_t pipe_mask, old_mask;
+    sigemptyset(&pipe_mask);
+    sigaddset(&pipe_mask, SIGPIPE);
+    sigprocmask(SIG_BLOCK, &pipe_mask, &old_mask);
+    relay_pipe(relay, fd == relay->in_fds[0] ? 0 : 1);
+    // Discard the SIGPIPE the splice raised before unblocking it
+    struct timespec no_wait = {0, 0};
+    while (sigtimedwait(&pipe_mask, NULL, &no_wait) == SIGPIPE) {
+        // Keep discarding until none is pending
+    }
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+}
+
+void start_relay(int out_fd, int err_fd, int next_fd) {
+    relay_t *relay = malloc(sizeof(relay_t));
+    relay->in_fds[0] = out_fd;
+    relay->in_fds[1] = err_fd;
+    relay->next_fd = next_fd;
+    // The shell never blocks on a full pipe, it waits for it to become writable instead
+    fcntl(next_fd, F_SETFL, fcntl(next_fd, F_GETFL) | O_NONBLOCK);
+    event_loop_add_fd(out_fd, relay_input, relay);
+    if (err_fd != -1) {
+        event_loop_add_fd(err_fd, relay_input, relay);
+    }
+}
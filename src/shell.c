@@ -1,25 +1,549 @@
+#define _GNU_SOURCE
 #include "shell.h"
+#include <sys/pidfd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <malloc.h>
+#include <limits.h>
+
+// Command lines at least this long are lexed with a bitmask index
+#define INDEX_MIN_LINE 256
 
 extern char **environ;
 extern msh_t *shell;
 extern volatile sig_atomic_t fg_pid;
+extern volatile sig_atomic_t fg_pseudo_signal;
 
-msh_t *alloc_shell(int max_jobs, int max_line, int max_history) {
+msh_t *alloc_shell(int max_jobs, int max_line, int max_history, bool use_zygote) {
+    // Fork the zygote first, while the shell owns as little memory as possible
+    zygote_t *zygote = use_zygote ? start_zygote() : NULL;
+    if (use_zygote && zygote == NULL) {
+        perror("msh: zygote");
+    }
     msh_t *shell = malloc(sizeof(msh_t));
+    shell->zygote = zygote;
     // Checks if parameters are 0, if so, set to default constant values
     // Otherwise, set to the parameters provided
     shell->max_jobs = max_jobs == 0 ? 16 : max_jobs; 
     shell->max_line = max_line == 0 ? 1024 : max_line;
     shell->max_history = max_history == 0 ? 10 : max_history;
+    // Launch external commands with posix_spawn unless -X fork is requested
+    shell->launch_mode = LAUNCH_SPAWN;
     // Allocate memory for jobs to the size of max_jobs
-    shell->jobs = malloc(shell->max_jobs * sizeof(job_t));
+    shell->jobs = alloc_jobs(shell->max_jobs);
+    // The jobs array grows on demand, without a hard limit unless the caller sets one (-j or -J)
+    shell->max_jobs_limit = 0;
+    // Allocate the queue of background jobs waiting for the jobs array to have room
+    shell->job_queue = alloc_job_queue();
     // Allocate memory for history to the size of max_history
     shell->history = alloc_history(shell->max_history);
+    // Allocate the table of command locations found in PATH
+    shell->path_cache = alloc_path_cache();
+    // The input the commands are read from is set up by the caller
+    shell->input = NULL;
+    // Allocate the arena for the data that only lives while a command line is evaluated
+    shell->line_arena = alloc_arena();
+    // echo, true, false, printf and sleep are launched as programs unless set -o builtins is given
+    shell->fast_builtins = false;
+    // The stages of a pipeline share their pipes unless set -o relay is given
+    shell->relay = false;
+    // Prompts are only shown to a terminal, the caller clears this for scripts and -c
+    shell->interactive = isatty(STDIN_FILENO);
+    // Job notifications are written as soon as the shell handles them unless set +b is given
+    shell->notify = true;
+    // Background jobs write to the terminal unless they are started with &> or set -o capture is given
+    shell->capture = false;
+    // Jobs run without a deadline unless they are started with timeout or set -o timeout is given
+    shell->timeout_ms = 0;
+    // Background jobs start right away unless set -o sched is given, then they wait while a task stalls
+    // on the CPU 50% of the time, on memory 10% of the time, or the load is above the number of CPUs
+    shell->sched = false;
+    shell->sched_limits = (pressure_limits_t){50, 10, sysconf(_SC_NPROCESSORS_ONLN)};
+    // Create the event loop before the signal handlers register the SIGCHLD signalfd with it
+    event_loop_init();
     // Initialize jobs
     initialize_signal_handlers();
+    // The jobs launched by the zygote are reaped by the zygote, which forwards their state changes
+    if (shell->zygote != NULL) {
+        watch_zygote(shell->zygote->event_fd);
+    }
     return shell;
 }
 
+static bool reserve_job_slot(msh_t *shell) {
+    // Helper function to make sure add_job succeeds
+    if (!jobs_full(shell->jobs, shell->max_jobs)) {
+        return true;
+    }
+    // The jobs array cannot grow past the hard limit given with -J
+    if (shell->max_jobs_limit != 0 && shell->max_jobs >= shell->max_jobs_limit) {
+        return false;
+    }
+    // Double the jobs array, but do not go past the hard limit
+    int max_jobs = shell->max_jobs * 2;
+    if (shell->max_jobs_limit != 0 && max_jobs > shell->max_jobs_limit) {
+        max_jobs = shell->max_jobs_limit;
+    }
+    shell->jobs = grow_jobs(shell->jobs, max_jobs);
+    shell->max_jobs = max_jobs;
+    return true;
+}
+
+static pid_t launch_job(const char *path, char **argv, pid_t pgid, const int *fds, bool more_stages) {
+    // Helper function to start an external command or a stage of a pipeline, through the zygote if there is one
+    // Output of the shell and of earlier fast builtins must come before the output of the child
+    fflush(stdout);
+    uint64_t start = STATS_START();
+    pid_t pid;
+    if (shell->zygote != NULL) {
+        pid = zygote_launch(shell->zygote, shell->launch_mode, path, argv, pgid, fds, more_stages);
+    } else {
+        // SIGCHLD stays blocked in the shell, it is only read from the event loop
+        pid = launch_process(shell->launch_mode, path, argv, child_signal_mask(), pgid, fds);
+    }
+    STATS_RECORD(STAT_LAUNCH, start);
+    return pid;
+}
+
+static capture_t *capture_output(bool wanted, int *fds) {
+    // Helper function to point the stdout and stderr of a job at a new capture, the caller closes fds[1] after the launch
+    if (!wanted) {
+        return NULL;
+    }
+    int write_fd;
+    capture_t *capture = start_capture(&write_fd);
+    if (capture != NULL) {
+        fds[1] = write_fd;
+        fds[2] = write_fd;
+    }
+    return capture;
+}
+
+static void attach_capture(pid_t pid, capture_t *capture) {
+    // Helper function to hand a capture to the job that was just added, its lines are tagged with the job number
+    if (capture != NULL) {
+        job_t *job = find_job(shell->jobs, shell->max_jobs, pid);
+        job->capture = capture;
+        capture->jid = job->jid;
+    }
+}
+
+static void job_deadline(void *data) {
+    // Helper function called by the event loop when the deadline of a job passed, SIGTERM first and SIGKILL
+    // if the job is still there after the grace period
+    pid_t pid = (pid_t)(intptr_t)data;
+    job_t *job = find_job(shell->jobs, shell->max_jobs, pid);
+    if (job == NULL) {
+        return;
+    }
+    int sig = job->timeout_signal == 0 ? SIGTERM : SIGKILL;
+    job->timeout_signal = sig;
+    job->timeout_timer = sig == SIGTERM ? event_loop_add_timer(TIMEOUT_GRACE_MS, job_deadline, data) : -1;
+    // A pseudo job ends on either signal, the job is gone afterwards
+    if (signal_pseudo_job(pid, sig)) {
+        return;
+    }
+    // Every process of the job is signalled through its process group, a stopped job must run to handle SIGTERM
+    kill(-pid, sig);
+    if (sig == SIGTERM) {
+        kill(-pid, SIGCONT);
+    }
+}
+
+static void start_deadline(pid_t pid, long timeout_ms) {
+    // Helper function to give the job that was just added a deadline, 0 for none
+    if (timeout_ms > 0) {
+        job_t *job = find_job(shell->jobs, shell->max_jobs, pid);
+        job->timeout_timer = event_loop_add_timer(timeout_ms, job_deadline, (void *)(intptr_t)pid);
+    }
+}
+
+static long interval_ms(double seconds) {
+    // Helper function to round an interval up to milliseconds, without overflowing the timers
+    return seconds * 1000 > (double)LONG_MAX / 2 ? LONG_MAX / 2 : (long)(seconds * 1000 + 0.999);
+}
+
+static bool host_overloaded(void) {
+    // Helper function to check the pressure and load of the host against the limits of the scheduler
+    pressure_t pressure;
+    read_pressure(&pressure);
+    return over_limits(&pressure, &shell->sched_limits);
+}
+
+// The timer that lets the scheduler check the pressure again, -1 if it is not armed
+static int sched_timer = -1;
+
+static void sched_poll(void *data) {
+    sched_timer = -1;
+    admit_queued_jobs(shell);
+}
+
+static void schedule_admission(void) {
+    // Helper function to check again later whether queued jobs can be launched, while the scheduler holds them
+    if (shell->sched && shell->job_queue->count > 0 && sched_timer == -1) {
+        sched_timer = event_loop_add_timer(SCHED_POLL_MS, sched_poll, NULL);
+    }
+}
+
+void admit_queued_jobs(msh_t *shell) {
+    // Launch queued jobs in FIFO order for as long as there are free slots
+    int launched = 0;
+    while (shell->job_queue->count > 0 && reserve_job_slot(shell)) {
+        // The scheduler lets one job go per check while the host is not overloaded, the readings lag behind the launches
+        if (shell->sched && (launched > 0 || host_overloaded())) {
+            break;
+        }
+        launched++;
+        queued_job_t *job = dequeue_job(shell->job_queue);
+        int fds[3] = {-1, -1, -1};
+        capture_t *capture = capture_output(job->capture, fds);
+        pid_t pid = launch_job(job->path, job->argv, 0, capture != NULL ? fds : NULL, false);
+        if (capture != NULL) {
+            close(fds[1]);
+        }
+        if (pid > 0) {
+            add_job(shell->jobs, shell->max_jobs, pid, BACKGROUND, job->cmd_line);
+            attach_capture(pid, capture);
+            start_deadline(pid, job->timeout_ms);
+            watch_child(pid);
+            printf("pid %d %s \t %s\n", pid, "Running", job->cmd_line);
+        } else if (capture != NULL) {
+            end_capture(capture);
+        }
+        free_queued_job(job);
+    }
+    schedule_admission();
+}
+
+// The time spent waiting for jobs, which evaluate does not count as its own
+static uint64_t waiting_ns = 0;
+
+static void pause_input(bool paused) {
+    // Helper function to stop (or resume) reading commands while the shell waits for jobs
+    if (shell->input != NULL) {
+        event_loop_pause_fd(shell->input->fd, paused);
+    }
+}
+
+static void wait_foreground(pid_t pid) {
+    // Helper function to run the event loop until the foreground job terminates or stops
+    uint64_t start = STATS_START();
+    fg_pid = pid;
+    // The foreground job owns stdin, stop reading commands until it is done
+    pause_input(true);
+    // When the foreground job terminates or stops, fg_pid will be set to 0
+    while (fg_pid != 0) {
+        // Without a terminal the output is only flushed before a child is launched
+        if (shell->interactive) {
+            fflush(stdout);
+        }
+        event_loop_run_once(-1);
+        // A pseudo job has no process to receive ctrl-c and ctrl-z, the signal handlers leave the signal here
+        if (fg_pseudo_signal != 0) {
+            int sig = fg_pseudo_signal;
+            fg_pseudo_signal = 0;
+            signal_pseudo_job(fg_pid, sig);
+        }
+    }
+    pause_input(false);
+    // Report the foreground job before the commands after it run
+    if (shell->notify) {
+        flush_notifications(shell->interactive, NULL);
+    }
+    waiting_ns += STATS_START() - start;
+}
+
+static pid_t job_arg_pid(const char *job_arg) {
+    // Helper function to get the pid of the job given as %JOB_ID or PID, -1 if there is no such job
+    bool is_job_id = job_arg[0] == '%';
+    int job_num = atoi(is_job_id ? job_arg + 1 : job_arg);
+    if (is_job_id) {
+        return get_job_pid(shell->jobs, shell->max_jobs, job_num);
+    }
+    return find_job(shell->jobs, shell->max_jobs, job_num) != NULL ? job_num : -1;
+}
+
+static void signal_job(pid_t pid, int sig) {
+    // Helper function to signal the process group of a job, the children of a command are stopped and
+    // continued with it like ctrl-z and the deadline of a job do
+    if (signal_pseudo_job(pid, sig)) {
+        return;
+    }
+    job_t *job = find_job(shell->jobs, shell->max_jobs, pid);
+    if (job != NULL && job->stages == NULL && job->pidfd != -1 && pidfd_send_signal(job->pidfd, 0, NULL, 0) < 0) {
+        // The leader is gone, its pid may already belong to an unrelated process group
+        return;
+    }
+    kill(-pid, sig);
+}
+
+static void wait_jobs(char **job_args, bool any) {
+    // Helper function to run the event loop until the given jobs (every job if none are given) terminate,
+    // or until one of them terminates if any is true
+    // Every job in the table, or one pid per argument (the same job may be given more than once)
+    int capacity = shell->max_jobs;
+    if (job_args[0] != NULL) {
+        capacity = 0;
+        while (job_args[capacity] != NULL) {
+            capacity++;
+        }
+    }
+    pid_t *pids = malloc(capacity * sizeof(pid_t));
+    if (pids == NULL) {
+        perror("wait");
+        return;
+    }
+    int count = 0;
+    if (job_args[0] == NULL) {
+        for (int jid = 1; jid <= shell->max_jobs; jid++) {
+            pid_t pid = get_job_pid(shell->jobs, shell->max_jobs, jid);
+            if (pid != -1) {
+                pids[count++] = pid;
+            }
+        }
+    } else {
+        for (int i = 0; job_args[i] != NULL; i++) {
+            pid_t pid = job_arg_pid(job_args[i]);
+            if (pid == -1) {
+                printf("wait: %s: no such job\n", job_args[i]);
+                continue;
+            }
+            pids[count++] = pid;
+        }
+    }
+    // Only the pidfds of jobs and the SIGCHLD signalfd can wake the shell while stdin is paused
+    uint64_t start = STATS_START();
+    pause_input(true);
+    int running_before = -1;
+    while (true) {
+        // Stopped jobs would never terminate, so they are not waited for
+        int running = 0;
+        for (int i = 0; i < count; i++) {
+            job_t *job = find_job(shell->jobs, shell->max_jobs, pids[i]);
+            if (job != NULL && job->state != SUSPENDED) {
+                running++;
+            }
+        }
+        if (running_before == -1) {
+            running_before = running;
+        }
+        if (running == 0 || (any && running < running_before)) {
+            break;
+        }
+        if (shell->interactive) {
+            fflush(stdout);
+        }
+        event_loop_run_once(-1);
+    }
+    pause_input(false);
+    waiting_ns += STATS_START() - start;
+    free(pids);
+}
+
+static char **substitute_argument(char **cmd, const char *arg) {
+    // Helper function to build the argv of one parallel job, every {} in cmd is replaced by arg,
+    // or arg is appended if cmd has no {}. The strings are allocated together with argv in the line arena
+    size_t arg_len = strlen(arg);
+    size_t bytes = 0;
+    bool placeholder = false;
+    int argc;
+    for (argc = 0; cmd[argc] != NULL; argc++) {
+        size_t len = strlen(cmd[argc]);
+        for (const char *p = strstr(cmd[argc], "{}"); p != NULL; p = strstr(p + 2, "{}")) {
+            len += arg_len - 2;
+            placeholder = true;
+        }
+        bytes += len + 1;
+    }
+    int count = placeholder ? argc : argc + 1;
+    if (!placeholder) {
+        bytes += arg_len + 1;
+    }
+    char **argv = arena_alloc(shell->line_arena, (count + 1) * sizeof(char *) + bytes);
+    char *dst = (char *)(argv + count + 1);
+    for (int i = 0; i < argc; i++) {
+        argv[i] = dst;
+        const char *src = cmd[i];
+        const char *p;
+        while ((p = strstr(src, "{}")) != NULL) {
+            memcpy(dst, src, p - src);
+            dst += p - src;
+            memcpy(dst, arg, arg_len);
+            dst += arg_len;
+            src = p + 2;
+        }
+        strcpy(dst, src);
+        dst += strlen(src) + 1;
+    }
+    if (!placeholder) {
+        argv[argc] = dst;
+        strcpy(dst, arg);
+    }
+    argv[count] = NULL;
+    return argv;
+}
+
+static char *next_argument(input_t *input) {
+    // Helper function to read the next non-empty line of input, NULL at the end of the file
+    char *arg;
+    while ((arg = input_next_line(input)) == NULL || arg[0] == '\0') {
+        if (arg != NULL) {
+            continue;
+        }
+        if (input->eof || (input_read(input) < 0 && errno != EINTR)) {
+            return NULL;
+        }
+    }
+    return arg;
+}
+
+static bool jobs_running(void) {
+    // Helper function to check whether any job that is not stopped is left to free its slot
+    for (int i = 0; i < shell->max_jobs; i++) {
+        if (shell->jobs[i].pid != 0 && shell->jobs[i].state != SUSPENDED) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void parallel_jobs(char **argv) {
+    // Helper function for parallel [-j N] [-a FILE] CMD [ARGS...], which runs CMD once per line of input
+    // with at most N jobs in flight, launching the next one as soon as one is reaped
+    long workers = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *file = NULL;
+    int i = 1;
+    while (argv[i] != NULL && argv[i][0] == '-') {
+        if (strcmp(argv[i], "-j") == 0 && argv[i + 1] != NULL && atoi(argv[i + 1]) > 0) {
+            workers = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-a") == 0 && argv[i + 1] != NULL) {
+            file = argv[i + 1];
+        } else {
+            break;
+        }
+        i += 2;
+    }
+    if (argv[i] == NULL || argv[i][0] == '-') {
+        printf("parallel: usage: parallel [-j N] [-a FILE] CMD [ARGS...]\n");
+        return;
+    }
+    char **cmd = argv + i;
+    const char *path = path_cache_lookup(shell->path_cache, cmd[0]);
+    if (path == NULL) {
+        printf("%s: Command not found.\n", cmd[0]);
+        return;
+    }
+    // The arguments are read from FILE, or from the rest of the input of the shell
+    input_t *input = shell->input;
+    if (file != NULL) {
+        int fd = open(file, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            printf("parallel: %s: %s\n", file, strerror(errno));
+            return;
+        }
+        input = alloc_input(fd);
+    } else if (input == NULL) {
+        input = shell->input = alloc_input(STDIN_FILENO);
+    } else if (input->fd != STDIN_FILENO) {
+        // The commands of the shell come from a script, the arguments from stdin
+        input = alloc_input(STDIN_FILENO);
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    // The pids of the jobs in flight, 0 marks a free worker
+    pid_t *pids = calloc(workers, sizeof(pid_t));
+    if (pids == NULL) {
+        perror("parallel");
+        if (input != shell->input) {
+            if (file != NULL) {
+                close(input->fd);
+            }
+            free_input(input);
+        }
+        return;
+    }
+    int launched = 0;
+    int running = 0;
+    bool more = true;
+    pause_input(true);
+    while (more || running > 0) {
+        // Forget the jobs that were reaped and find a free worker
+        int free_worker = -1;
+        running = 0;
+        for (int w = 0; w < workers; w++) {
+            if (pids[w] != 0 && find_job(shell->jobs, shell->max_jobs, pids[w]) == NULL) {
+                pids[w] = 0;
+            }
+            if (pids[w] != 0) {
+                running++;
+            } else if (free_worker == -1) {
+                free_worker = w;
+            }
+        }
+        if (!more || free_worker == -1 || !reserve_job_slot(shell)) {
+            if (!more && running == 0) {
+                break;
+            }
+            // Wait for a job to be reaped, one of ours or, when the jobs array is full, any other job
+            if (running == 0 && !jobs_running()) {
+                // Only stopped jobs hold the slots, none of them can free one
+                printf("parallel: reached the maximum jobs limit\n");
+                break;
+            }
+            if (shell->interactive) {
+                fflush(stdout);
+            }
+            event_loop_run_once(-1);
+            continue;
+        }
+        char *arg = next_argument(input);
+        if (arg == NULL) {
+            more = false;
+            continue;
+        }
+        arena_mark_t mark = arena_mark(shell->line_arena);
+        char **job_argv = substitute_argument(cmd, arg);
+        pid_t pid = launch_job(path, job_argv, 0, NULL, false);
+        if (pid > 0) {
+            // The job is shown with its whole command line, as if it was typed with &
+            size_t cmd_len = 0;
+            for (char **a = job_argv; *a != NULL; a++) {
+                cmd_len += strlen(*a) + 1;
+            }
+            char *cmd_line = arena_alloc(shell->line_arena, cmd_len);
+            char *end = cmd_line;
+            for (char **a = job_argv; *a != NULL; a++) {
+                end = stpcpy(end, *a);
+                *end++ = ' ';
+            }
+            end[-1] = '\0';
+            add_job(shell->jobs, shell->max_jobs, pid, BACKGROUND, cmd_line);
+            watch_child(pid);
+            pids[free_worker] = pid;
+            running++;
+            launched++;
+        }
+        arena_release(shell->line_arena, mark);
+    }
+    pause_input(false);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    free(pids);
+    if (input != shell->input) {
+        if (file != NULL) {
+            close(input->fd);
+        }
+        free_input(input);
+    } else if (isatty(input->fd)) {
+        // ctrl-d only ends the arguments, the shell keeps reading commands from the terminal
+        input->eof = false;
+    }
+    // Report the aggregate throughput
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("parallel: %d jobs, %ld at a time, %.3f s, %.1f jobs/s\n", launched, workers, seconds, seconds > 0 ? launched / seconds : 0.0);
+}
+
 int is_empty_or_whitespace(const char *str) {
     // Helper function to check if a string is empty or contains only whitespace
     while (*str != '\0') {
@@ -36,10 +560,18 @@ char *parse_tok(char *line, int *job_type) {
     // Initialize a static pointer to keep track of index position in line 
     // line_ptr is set to NULL for the first call to parse_tok
     static char *line_ptr = NULL;
-    // If line is not NULL, this is the first call, set line_ptr to line
+    uint64_t start = STATS_START();
+    char *command = parse_tok_r(line, job_type, &line_ptr);
+    STATS_RECORD(STAT_PARSE, start);
+    return command;
+}
+
+char *parse_tok_r(char *line, int *job_type, char **saveptr) {
+    // If line is not NULL, this is the first call, set the saved position to line
     if (line != NULL) {
-        line_ptr = line;
+        *saveptr = line;
     }
+    char *line_ptr = *saveptr;
     // If line_ptr is NULL, there is no more commands to parse or it is an empty command
     if ((line_ptr == NULL || *line_ptr == '\0') && job_type != NULL) {
         *job_type = 1;
@@ -52,7 +584,7 @@ char *parse_tok(char *line, int *job_type) {
     // If '&' or ';' is not found, this is the last command in line
     if (job_cat_ptr == NULL && job_type != NULL) {
         *job_type = 1;
-        line_ptr = NULL;
+        *saveptr = NULL;
         if (is_empty_or_whitespace(command)) {
             // If command is empty or contains only whitespace, return NULL
             return NULL;
@@ -71,38 +603,367 @@ char *parse_tok(char *line, int *job_type) {
         }
     } 
     // Move pointer to the next character after '\0' which we replaced to continue parsing 
-    line_ptr = ++job_cat_ptr;
+    *saveptr = ++job_cat_ptr;
     return command;
 }
 
+// Classes of the characters of a command line, looked up once per character by the lexer
+enum {CHAR_WORD, CHAR_SPACE, CHAR_JOB, CHAR_END};
+static const unsigned char char_class[256] = {
+    ['\0'] = CHAR_END, [' '] = CHAR_SPACE, ['\t'] = CHAR_SPACE, ['\n'] = CHAR_SPACE,
+    ['\v'] = CHAR_SPACE, ['\f'] = CHAR_SPACE, ['\r'] = CHAR_SPACE, ['&'] = CHAR_JOB, [';'] = CHAR_JOB,
+};
+
+static int lex(char **cursor, char **argv, bool split_jobs, int *job_type) {
+    // Shared single pass of lex_command and separate_args, a separator only ends the command if split_jobs is true
+    char *p = *cursor;
+    int argc = 0;
+    while (true) {
+        // Skip the whitespace before the next word
+        while (char_class[(unsigned char)*p] == CHAR_SPACE) {
+            p++;
+        }
+        if (*p == '\0' || (split_jobs && char_class[(unsigned char)*p] == CHAR_JOB)) {
+            break;
+        }
+        argv[argc++] = p;
+        // Find the end of the word, the '&' of the pipe operator |& is part of the word
+        unsigned char c;
+        while ((c = char_class[(unsigned char)*p]) == CHAR_WORD || (!split_jobs && c == CHAR_JOB) || (*p == '&' && p[-1] == '|')) {
+            p++;
+        }
+        if (c == CHAR_SPACE) {
+            *p++ = '\0';
+        } else if (c == CHAR_JOB) {
+            // Keep the separator for the check above, the word is terminated when the command ends
+            break;
+        }
+    }
+    // The command ends with '&' (a background job), '&>' (a background job whose output is captured), ';' or the end of the line
+    *job_type = *p == '&' ? (p[1] == '>' ? 2 : 0) : 1;
+    if (*p == '\0') {
+        *cursor = NULL;
+    } else {
+        *p = '\0';
+        *cursor = *job_type == 2 ? p + 2 : p + 1;
+    }
+    argv[argc] = NULL;
+    return argc;
+}
+
+int count_args(const char *line) {
+    int count = 0;
+    bool in_word = false;
+    for (const unsigned char *p = (const unsigned char *)line; *p != '\0'; p++) {
+        // A word starts at every word character that follows whitespace or a separator, the '&' of |& is a word character
+        bool word = char_class[*p] == CHAR_WORD || (*p == '&' && (const char *)p > line && p[-1] == '|');
+        count += word && !in_word;
+        in_word = word;
+    }
+    return count;
+}
+
+int lex_command(char **cursor, char **argv, int *job_type) {
+    return lex(cursor, argv, true, job_type);
+}
+
+line_index_t *index_line(arena_t *arena, char *line, size_t len) {
+    line_index_t *index = arena_alloc(arena, sizeof(line_index_t));
+    size_t words = (len + 63) / 64;
+    index->line = line;
+    index->len = len;
+    index->spaces = arena_alloc(arena, words * sizeof(uint64_t));
+    index->separators = arena_alloc(arena, words * sizeof(uint64_t));
+    classify_line(line, len, index->spaces, index->separators);
+    // The '&' of the pipe operator |& does not end the command, the '>' of &> is part of the separator
+    for (size_t w = 0; w < words; w++) {
+        for (uint64_t bits = index->separators[w]; bits != 0; bits &= bits - 1) {
+            size_t p = w * 64 + __builtin_ctzll(bits);
+            if (p > 0 && line[p] == '&' && line[p - 1] == '|') {
+                index->separators[w] &= ~((uint64_t)1 << (p % 64));
+            } else if (line[p] == '&' && line[p + 1] == '>') {
+                index->spaces[(p + 1) / 64] |= (uint64_t)1 << ((p + 1) % 64);
+            }
+        }
+    }
+    return index;
+}
+
+int count_args_indexed(const line_index_t *index) {
+    // A word starts at every word character whose previous character is whitespace or a separator
+    size_t words = (index->len + 63) / 64;
+    uint64_t previous = 0;
+    int count = 0;
+    for (size_t w = 0; w < words; w++) {
+        uint64_t word = ~(index->spaces[w] | index->separators[w]);
+        if (w == words - 1 && index->len % 64 != 0) {
+            word &= ((uint64_t)1 << (index->len % 64)) - 1;
+        }
+        count += __builtin_popcountll(word & ~((word << 1) | previous));
+        previous = word >> 63;
+    }
+    return count;
+}
+
+int lex_command_indexed(const line_index_t *index, char **cursor, char **argv, int *job_type) {
+    char *line = index->line;
+    size_t len = index->len;
+    size_t pos = *cursor - line;
+    size_t words = (len + 63) / 64;
+    int argc = 0;
+    for (size_t w = pos / 64; w < words; w++) {
+        uint64_t word = ~(index->spaces[w] | index->separators[w]);
+        if (w == words - 1 && len % 64 != 0) {
+            word &= ((uint64_t)1 << (len % 64)) - 1;
+        }
+        // A word starts where the previous character is not a word character and ends at the first
+        // character that is not, visit those positions and the separators in order
+        uint64_t previous = w == 0 ? 0 : ~(index->spaces[w - 1] | index->separators[w - 1]) >> 63;
+        uint64_t shifted = (word << 1) | previous;
+        uint64_t events = (word & ~shifted) | (~word & shifted) | index->separators[w];
+        if (w == pos / 64) {
+            events &= ~(uint64_t)0 << (pos % 64);
+        }
+        while (events != 0) {
+            int bit = __builtin_ctzll(events);
+            events &= events - 1;
+            size_t p = w * 64 + bit;
+            if (p >= len) {
+                break;
+            }
+            if (index->separators[w] >> bit & 1) {
+                // The command ends with '&' (a background job), '&>' or ';'
+                *job_type = line[p] == '&' ? (line[p + 1] == '>' ? 2 : 0) : 1;
+                line[p] = '\0';
+                *cursor = line + p + 1;
+                argv[argc] = NULL;
+                return argc;
+            }
+            if (word >> bit & 1) {
+                argv[argc++] = line + p;
+            } else {
+                line[p] = '\0';
+            }
+        }
+    }
+    // The command ends at the end of the line
+    *job_type = 1;
+    *cursor = NULL;
+    argv[argc] = NULL;
+    return argc;
+}
+
+
 char **separate_args(char *line, int *argc, bool *is_builtin) {
-    char **argv = NULL;
-    char *token;
     *argc = 0;
     // If the line is empty, return NULL
     if (line == NULL || line[0] == '\0') {
         return NULL;
     }
-    // Tokenize the line and store the tokens in argv
-    token = strtok(line, " ");
-    while (token != NULL) {
-        // Increase the size of argv by 1
-        (*argc)++;
-        // Resize the memory allocated to argv by 1
-        // Size of argv should always be larger than argc by 1 for last NULL element
-        argv = realloc(argv, ((*argc)+1) * (sizeof(char *)));
-        // Assign token command to argv
-        argv[(*argc) - 1] = token;
-        // Continue tokenizing the line
-        token = strtok(NULL, " ");
-    }
-    // Add NULL to the end of argv so C knows we have reached the end of the array
-    if (argv != NULL) {
-        argv[*argc] = NULL;
+    // Allocate argv once, sized from the number of words, separators are part of the words here
+    int max_args = 0;
+    bool in_word = false;
+    for (const unsigned char *p = (const unsigned char *)line; *p != '\0'; p++) {
+        bool word = char_class[*p] != CHAR_SPACE;
+        max_args += word && !in_word;
+        in_word = word;
     }
+    if (max_args == 0) {
+        return NULL;
+    }
+    uint64_t start = STATS_START();
+    char **argv = malloc((max_args + 1) * sizeof(char *));
+    int job_type;
+    char *cursor = line;
+    *argc = lex(&cursor, argv, false, &job_type);
+    STATS_RECORD(STAT_PARSE, start);
     return argv;
 }
 
+int split_pipeline(arena_t *arena, char **argv, char ****stages, bool **merge_stderr) {
+    // Count the pipe operators, every one may also split a word in two (i.e. a|b)
+    int argc = 0;
+    int pipes = 0;
+    for (; argv[argc] != NULL; argc++) {
+        for (const char *p = argv[argc]; *p != '\0'; p++) {
+            pipes += *p == '|';
+        }
+    }
+    if (pipes == 0) {
+        return 1;
+    }
+    // The arguments of every stage are stored one after the other, each terminated by NULL
+    char **words = arena_alloc(arena, (argc + 2 * pipes + 1) * sizeof(char *));
+    *stages = arena_alloc(arena, (pipes + 1) * sizeof(char **));
+    *merge_stderr = arena_alloc(arena, (pipes + 1) * sizeof(bool));
+    int num_words = 0;
+    int num_stages = 0;
+    int stage_start = 0;
+    for (int i = 0; i <= argc; i++) {
+        char *p = argv[i];
+        while (p != NULL) {
+            char *bar = strchr(p, '|');
+            // The part of the word before the operator is an argument of the current stage
+            if (bar == NULL ? *p != '\0' : bar > p) {
+                words[num_words++] = p;
+            }
+            if (bar == NULL) {
+                break;
+            }
+            bool merge = bar[1] == '&';
+            *bar = '\0';
+            if (num_words == stage_start) {
+                // An operator without a command before it
+                return -1;
+            }
+            words[num_words++] = NULL;
+            (*stages)[num_stages] = words + stage_start;
+            (*merge_stderr)[num_stages++] = merge;
+            stage_start = num_words;
+            p = bar + (merge ? 2 : 1);
+        }
+    }
+    // The last stage ends with the command
+    if (num_words == stage_start) {
+        return -1;
+    }
+    words[num_words] = NULL;
+    (*stages)[num_stages] = words + stage_start;
+    (*merge_stderr)[num_stages++] = false;
+    return num_stages;
+}
+
+static void print_self_usage(job_t *self, const struct rusage *before) {
+    // Helper function to print the resources the shell used since before, for commands timed in the shell process
+    struct rusage after;
+    getrusage(RUSAGE_SELF, &after);
+    timersub(&after.ru_utime, &before->ru_utime, &after.ru_utime);
+    timersub(&after.ru_stime, &before->ru_stime, &after.ru_stime);
+    after.ru_nvcsw -= before->ru_nvcsw;
+    after.ru_nivcsw -= before->ru_nivcsw;
+    add_usage(self, &after);
+    finish_usage(self);
+    // The output of the command comes first
+    fflush(stdout);
+    print_usage(stderr, &self->usage);
+}
+
+static void run_pipeline(char ***stages, bool *merge_stderr, int num_stages, int job_type, bool timed, bool capture, long timeout_ms) {
+    // Helper function to launch the stages of a pipeline as one job in one process group
+    const char **paths = arena_alloc(shell->line_arena, num_stages * sizeof(char *));
+    size_t cmd_len = 0;
+    for (int i = 0; i < num_stages; i++) {
+        paths[i] = path_cache_lookup(shell->path_cache, stages[i][0]);
+        if (paths[i] == NULL) {
+            printf("%s: Command not found.\n", stages[i][0]);
+            return;
+        }
+        cmd_len += strlen(stages[i][0]) + 4;
+    }
+    if (!reserve_job_slot(shell)) {
+        // The admission queue only holds single commands
+        printf("error: reached the maximum jobs limit\n");
+        return;
+    }
+    // The job is shown as the commands of its stages (i.e. yes | head)
+    char *cmd_line = arena_alloc(shell->line_arena, cmd_len);
+    char *end = cmd_line;
+    for (int i = 0; i < num_stages; i++) {
+        end = stpcpy(end, stages[i][0]);
+        if (i < num_stages - 1) {
+            end = stpcpy(end, merge_stderr[i] ? " |& " : " | ");
+        }
+    }
+    // Create the pipes between the stages before any stage starts, so a failure leaves nothing running.
+    // Stage i writes to pipe_fds[6 * i], with a relay the next stage reads from pipe_fds[6 * i + 2],
+    // and for |& through a relay the errors go to pipe_fds[6 * i + 4]
+    int num_pipe_fds = (num_stages - 1) * 6;
+    int *pipe_fds = arena_alloc(shell->line_arena, num_pipe_fds * sizeof(int));
+    memset(pipe_fds, -1, num_pipe_fds * sizeof(int));
+    for (int i = 0; i < num_stages - 1; i++) {
+        int *stage_pipes = pipe_fds + 6 * i;
+        if (pipe2(stage_pipes, O_CLOEXEC) < 0 || (shell->relay && pipe2(stage_pipes + 2, O_CLOEXEC) < 0)
+                || (shell->relay && merge_stderr[i] && pipe2(stage_pipes + 4, O_CLOEXEC) < 0)) {
+            perror("msh: pipe");
+            for (int j = 0; j < num_pipe_fds; j++) {
+                if (pipe_fds[j] != -1) {
+                    close(pipe_fds[j]);
+                }
+            }
+            return;
+        }
+    }
+    pid_t *pids = arena_alloc(shell->line_arena, num_stages * sizeof(pid_t));
+    pid_t pgid = 0;
+    int in_fd = -1;
+    // A captured pipeline writes the output of its last stage and the errors of every stage to the capture
+    int capture_fds[3] = {-1, -1, -1};
+    capture_t *output = capture_output(capture, capture_fds);
+    for (int i = 0; i < num_stages; i++) {
+        int fds[3] = {in_fd, capture_fds[1], capture_fds[2]};
+        int next_in = -1;
+        if (i < num_stages - 1) {
+            int *out_pipe = pipe_fds + 6 * i;
+            int *next_pipe = out_pipe + 2;
+            int *err_pipe = out_pipe + 4;
+            fds[1] = out_pipe[1];
+            if (shell->relay) {
+                // The shell sits between the stages and splices the output (and the errors for |&) to the next one
+                if (merge_stderr[i]) {
+                    fds[2] = err_pipe[1];
+                }
+                start_relay(out_pipe[0], err_pipe[0], next_pipe[1]);
+                next_in = next_pipe[0];
+            } else {
+                // The stages share the pipe, |& sends the errors down the same pipe
+                fds[2] = merge_stderr[i] ? out_pipe[1] : capture_fds[2];
+                next_in = out_pipe[0];
+            }
+        }
+        pids[i] = launch_job(paths[i], stages[i], pgid, fds, i < num_stages - 1);
+        // The first stage started leads the process group
+        if (pgid == 0 && pids[i] > 0) {
+            pgid = pids[i];
+        }
+        // Only the stages keep their ends of the pipes, the capture is closed once every stage has it
+        for (int j = 0; j < 3; j++) {
+            if (fds[j] != -1 && fds[j] != capture_fds[1] && (j == 0 || fds[j] != fds[j - 1])) {
+                close(fds[j]);
+            }
+        }
+        in_fd = next_in;
+    }
+    if (output != NULL) {
+        close(capture_fds[1]);
+    }
+    if (pgid == 0) {
+        if (output != NULL) {
+            end_capture(output);
+        }
+        return;
+    }
+    // Track the pipeline as one job, every stage is reaped through its own pidfd
+    add_job(shell->jobs, shell->max_jobs, pgid, job_type == 1 ? FOREGROUND : BACKGROUND, cmd_line);
+    find_job(shell->jobs, shell->max_jobs, pgid)->timed = timed;
+    attach_capture(pgid, output);
+    start_deadline(pgid, timeout_ms);
+    for (int i = 0; i < num_stages; i++) {
+        if (pids[i] > 0 && pids[i] != pgid) {
+            add_stage(shell->jobs, shell->max_jobs, pgid, pids[i]);
+        }
+    }
+    for (int i = 0; i < num_stages; i++) {
+        if (pids[i] > 0) {
+            watch_child(pids[i]);
+        }
+    }
+    if (job_type == 1) {
+        wait_foreground(pgid);
+    } else {
+        printf("pid %d %s \t %s\n", pgid, "Running", cmd_line);
+    }
+}
+
 int evaluate(msh_t *shell, char *line) {
     char * command = NULL;
     int job_type = 0;
@@ -112,7 +973,8 @@ int evaluate(msh_t *shell, char *line) {
     int max_line_limit = shell->max_line;
     int child_status;
     // Check if the line is too long
-    if (strlen(line) > shell->max_line) {
+    size_t len = strlen(line);
+    if (len > shell->max_line) {
         printf("error: reached the maximum line limit\n");
         return 0;
     }
@@ -128,119 +990,254 @@ int evaluate(msh_t *shell, char *line) {
         add_line_history(shell->history, line);
     }
 
-    do {
-        // While there are still commands to parse, parse the command 
-        command = parse_tok(command == NULL ? line : NULL, &job_type);
-        // Stop parsing if there are no more commands
-        if (command != NULL) {
-            // For each command, separate the arguments and print them all
-            argc = 0;
-            argv = separate_args(command, &argc, NULL);
-            if (argv == NULL) {
+    // The time the shell spends on the line, the time waiting for its jobs is taken out at the end
+    uint64_t eval_start = STATS_START();
+    uint64_t waiting_before = waiting_ns;
+    // Everything allocated while evaluating the line comes from the line arena and is released at the end
+    arena_mark_t mark = arena_mark(shell->line_arena);
+    // Long lines are classified once into a bitmask index, so the lexer skips over whole words at a time
+    line_index_t *index = len >= INDEX_MIN_LINE ? index_line(shell->line_arena, line, len) : NULL;
+    // Size the argument vector once for the whole line, no command in it has more arguments than the line has words
+    int max_args = index != NULL ? count_args_indexed(index) : count_args(line);
+    argv = arena_alloc(shell->line_arena, (max_args + 1) * sizeof(char *));
+    int status = 0;
+    char *cursor = line;
+    while (cursor != NULL && status == 0) {
+        // While there are still commands to parse, split the next command into its arguments
+        uint64_t parse_start = STATS_START();
+        argc = index != NULL ? lex_command_indexed(index, &cursor, argv, &job_type) : lex_command(&cursor, argv, &job_type);
+        STATS_RECORD(STAT_PARSE, parse_start);
+        if (argc == 0) {
+            continue;
+        }
+        // &> captures the output of a background job, set -o capture captures the output of every background job
+        bool capture = job_type == 2 || (job_type == 0 && shell->capture);
+        if (job_type == 2) {
+            job_type = 0;
+        }
+        // The arguments are split in place, so the command text is its first argument
+        command = argv[0];
+        // Check if this is an exit command
+        if (strcmp(argv[0], "exit") == 0) {
+            status = 1;
+            break;
+        }
+        // Check line length
+        int line_len = 0;
+        for (int i = 0; i < argc; i++) {
+            if (line_len > max_line_limit) {
+                status = 1;
+                break;
+            }
+            line_len += strlen(argv[i]);
+        }
+        if (status != 0) {
+            break;
+        }
+        // time CMD runs CMD like any other command and prints the resources it used once it is done
+        bool timed = strcmp(argv[0], "time") == 0;
+        struct rusage self_before;
+        job_t self = {0};
+        if (timed) {
+            if (argc == 1) {
+                printf("time: usage: time command\n");
+                continue;
+            }
+            memmove(argv, argv + 1, argc * sizeof(char *));
+            argc--;
+            command = argv[0];
+            // Commands run in the shell process are measured on the shell itself
+            getrusage(RUSAGE_SELF, &self_before);
+            clock_gettime(CLOCK_MONOTONIC, &self.usage.started);
+        }
+        // timeout DURATION CMD gives CMD a deadline, the other jobs get the one of set -o timeout
+        long timeout_ms = shell->timeout_ms;
+        if (strcmp(argv[0], "timeout") == 0) {
+            double seconds = argc > 2 ? parse_interval(argv[1]) : -1;
+            if (seconds < 0) {
+                printf("timeout: usage: timeout DURATION command\n");
                 continue;
             }
-            // Check if this is an exit command
-            if (strcmp(argv[0], "exit") == 0) {
-                free(argv);
-                return 1;
-            }
-            // Check line length
-            int line_len = 0;
-            for (int i = 0; i < argc; i++) {
-                if (line_len > max_line_limit) {
-                    free(argv);
-                    return 1;
+            timeout_ms = interval_ms(seconds);
+            memmove(argv, argv + 2, (argc - 1) * sizeof(char *));
+            argc -= 2;
+            command = argv[0];
+        }
+        // A pipeline runs its stages as external commands, built-in commands are not run in a pipeline
+        char ***stages;
+        bool *merge_stderr;
+        int num_stages = split_pipeline(shell->line_arena, argv, &stages, &merge_stderr);
+        if (num_stages < 0) {
+            printf("syntax error near unexpected token `|'\n");
+            continue;
+        } else if (num_stages > 1) {
+            run_pipeline(stages, merge_stderr, num_stages, job_type, timed, capture, timeout_ms);
+            continue;
+        }
+        // Check and if applicable, execute built-in commands
+        char *builtin_command = builtin_cmd(argv);
+        if (builtin_command != NULL && builtin_command != "1") {
+            // Execute the built-in command from history on a copy, evaluating
+            // modifies the line and adds to the history the line lives in
+            char *history_line = arena_strdup(shell->line_arena, builtin_command);
+            evaluate(shell, history_line);
+        } else if (builtin_command == "1") {
+            // A background job (&, &>) is launched as the program, so it shows up in jobs and wait like any other
+            if (shell->fast_builtins && job_type == 1 && run_fast_builtin(argv)) {
+                // A trivial utility that was run in the shell process, no job is created for it
+                if (timed) {
+                    print_self_usage(&self, &self_before);
                 }
-                line_len += strlen(argv[i]);
-            }
-            // Check and if applicable, execute built-in commands
-            char *builtin_command = builtin_cmd(argv);
-            if (builtin_command != NULL && builtin_command != "1") {
-                // Execute the built-in command from history
-                int status = evaluate(shell, builtin_command);
-            } else if (builtin_command == "1") {
-                // Not a built-in command, fork a new child process to execute the command
-                // Initialize for signal handling
-                sigset_t mask_one, prev_one, mask_all, prev_all;
-                Sigfillset(&mask_all);
-                Sigemptyset(&mask_one);
-                Sigaddset(&mask_one, SIGCHLD);
-                // Block child process
-                Sigprocmask(SIG_BLOCK, &mask_one, &prev_one);
-                // Fork a new child process to handle the execution of the current job
-                pid = fork();
-                if (pid == 0) {
-                    // Unblock child process
-                    Sigprocmask(SIG_SETMASK, &prev_one, NULL);
-                    // Put the child in a new process group whose group ID is identical to the child’s PID
-                    Setpgid(0, 0);
-                    // Child executes the command
-                    if (execve(argv[0], argv, environ) < 0) {    
-                        printf("%s: Command not found.\n", argv[0]);
-                        free(argv);
-                        exit(1);
-                    }
-                } else {
-                    // Block parent process
-                    Sigprocmask(SIG_BLOCK, &mask_all, &prev_all);
-                    if (job_type == 1) {
-                        // Add the foreground job to the jobs array
-                        if (! add_job(shell->jobs, shell->max_jobs, pid, FOREGROUND, command)) {
-                            // If there is no more capacity for more jobs, print error message and exit
-                            free(argv);
-                            return 1;
-                        }
-                    } else if (job_type == 0) {
-                        // Add the background job to the jobs array
-                        if (! add_job(shell->jobs, shell->max_jobs, pid, BACKGROUND, command)) {
-                            // If there is no more capacity for more jobs, print error message and exit
-                            free(argv);
-                            return 1;
-                        }
-                    }
-                    // Unblock parent process
-                    Sigprocmask(SIG_SETMASK, &prev_all, NULL);
-                    
-                    // If the job is a foreground job, wait for it to finish
+                continue;
+            }
+            long sleep_ms;
+            if (shell->fast_builtins && sleep_duration(argv, &sleep_ms)) {
+                if (sleep_ms < 0) {
+                    continue;
+                }
+                // Sleep on an event loop timer, the pseudo job is a job like any other for jobs, fg, bg, kill and wait
+                if (reserve_job_slot(shell)) {
+                    pid = start_pseudo_job(sleep_ms);
+                    add_job(shell->jobs, shell->max_jobs, pid, job_type == 1 ? FOREGROUND : BACKGROUND, command);
+                    find_job(shell->jobs, shell->max_jobs, pid)->timed = timed;
+                    start_deadline(pid, timeout_ms);
                     if (job_type == 1) {
-                        fg_pid = pid;
-                        // When the foreground job terminates, fg_pid will be set to 0
-                        // Before that, parent wait for child to terminate
-                        while (fg_pid != 0) {
-                            Sigsuspend(&prev_one);
-                        }
+                        wait_foreground(pid);
                     } else {
-                        // If the job is a background job, print the job info
                         printf("pid %d %s \t %s\n", pid, "Running", command);
-                    }   
+                    }
+                    continue;
+                }
+                // Without a free slot, sleep is launched or queued like any other program below
+            }
+            // Not a built-in command, find the program in PATH before launching anything
+            const char *path = path_cache_lookup(shell->path_cache, argv[0]);
+            if (path == NULL) {
+                printf("%s: Command not found.\n", argv[0]);
+                continue;
+            }
+            // In scheduler mode a background job waits behind the queued ones, or while the host is overloaded
+            bool hold = job_type == 0 && shell->sched && (shell->job_queue->count > 0 || host_overloaded());
+            // Make room for the job in the jobs array before launching it
+            if (hold || !reserve_job_slot(shell)) {
+                if (job_type == 0) {
+                    // The jobs array reached its hard limit, launch the background job once a slot frees up
+                    enqueue_job(shell->job_queue, path, argv, command);
+                    shell->job_queue->tail->capture = capture;
+                    shell->job_queue->tail->timeout_ms = timeout_ms;
+                    printf("pid - %s \t %s\n", "Queued", command);
+                    schedule_admission();
+                } else {
+                    printf("error: reached the maximum jobs limit\n");
+                }
+                continue;
+            }
+            // Launch a new child process to handle the execution of the current job
+            int fds[3] = {-1, -1, -1};
+            capture_t *output = capture_output(capture, fds);
+            pid = launch_job(path, argv, 0, output != NULL ? fds : NULL, false);
+            if (output != NULL) {
+                close(fds[1]);
+                if (pid <= 0) {
+                    end_capture(output);
                 }
-                // Unblock child process
-                Sigprocmask(SIG_SETMASK, &prev_one, NULL);
-                // Deallocate argv
-                free(argv);  
-            }         
+            }
+            if (pid > 0) {
+                // Add the job to the jobs array, a slot was reserved above
+                add_job(shell->jobs, shell->max_jobs, pid, job_type == 1 ? FOREGROUND : BACKGROUND, command);
+                find_job(shell->jobs, shell->max_jobs, pid)->timed = timed;
+                attach_capture(pid, output);
+                start_deadline(pid, timeout_ms);
+                // Reap the job through its own pidfd
+                watch_child(pid);
+                
+                // If the job is a foreground job, wait for it to finish
+                if (job_type == 1) {
+                    wait_foreground(pid);
+                } else {
+                    // If the job is a background job, print the job info
+                    printf("pid %d %s \t %s\n", pid, "Running", command);
+                }   
+            }
+        } else if (timed) {
+            // The built-in command was run in the shell process
+            print_self_usage(&self, &self_before);
         }
-    } while (command != NULL);
-    
-    return 0;
+    }
+    // Release argv and the other allocations of the line
+    arena_release(shell->line_arena, mark);
+    STATS_RECORD(STAT_EVALUATE, eval_start + (waiting_ns - waiting_before));
+    return status;
 }
 
 char *builtin_cmd(char **argv) {
     // Check if the command is a built-in command
     if (strcmp(argv[0], "jobs") == 0) {
-        // If the command is jobs, print the jobs
-        print_jobs(shell->jobs, shell->max_jobs);
+        if (argv[1] != NULL && strcmp(argv[1], "-q") == 0) {
+            // If the command is jobs -q, print the background jobs waiting for a free slot
+            print_job_queue(shell->job_queue);
+        } else if (argv[1] != NULL && strcmp(argv[1], "-l") == 0) {
+            // If the command is jobs -l, print the jobs with the resources they used and the pids of their stages
+            print_jobs_long(shell->jobs, shell->max_jobs);
+        } else if (argv[1] != NULL && strcmp(argv[1], "-o") == 0) {
+            // If the command is jobs -o, print the output captured for the job so far, the job keeps it
+            pid_t pid = argv[2] != NULL ? job_arg_pid(argv[2]) : -1;
+            job_t *job = pid != -1 ? find_job(shell->jobs, shell->max_jobs, pid) : NULL;
+            if (argv[2] == NULL) {
+                printf("jobs: usage: jobs -o %%JOB_ID\n");
+            } else if (job == NULL) {
+                printf("jobs: %s: no such job\n", argv[2]);
+            } else if (job->capture == NULL) {
+                printf("jobs: %s: output is not captured\n", argv[2]);
+            } else {
+                capture_read(job->capture);
+                print_capture(job->capture, STDOUT_FILENO);
+            }
+        } else {
+            // If the command is jobs, print the jobs
+            print_jobs(shell->jobs, shell->max_jobs);
+        }
         return NULL;
     } else if (strcmp(argv[0], "history") == 0) {
-        // If the command is history, print the history
-        print_history(shell->history);
+        if (argv[1] != NULL && argv[2] != NULL && strcmp(argv[1], "-b") == 0) {
+            // If the command is history -b, append lines to the history file in batches of the given size
+            set_history_commit(shell->history, atoi(argv[2]), shell->history->fsync_commits);
+        } else if (argv[1] != NULL && argv[2] != NULL && strcmp(argv[1], "-f") == 0) {
+            // If the command is history -f, sync the history file to disk after the given number of batches
+            set_history_commit(shell->history, shell->history->commit_lines, atoi(argv[2]));
+        } else if (argv[1] != NULL && argv[2] != NULL && strcmp(argv[1], "-s") == 0) {
+            // If the command is history -s, print the commands containing the pattern
+            print_history_matches(shell->history, argv[2]);
+        } else {
+            // If the command is history, print the history
+            print_history(shell->history);
+        }
         return NULL;
     } else if (argv[0][0] == '!') {
         // If the command is a specific history command, find the command in history
-        int history_num = atoi(&argv[0][1]);
+        char *event = &argv[0][1];
+        int history_num;
+        if (isdigit((unsigned char)event[0])) {
+            // !N recalls the command with the given number
+            history_num = atoi(event);
+        } else if (event[0] == '?') {
+            // !?pattern? recalls the most recent command containing pattern, the closing ? is optional
+            size_t event_len = strlen(event);
+            if (event_len > 1 && event[event_len - 1] == '?') {
+                event[event_len - 1] = '\0';
+            }
+            history_num = search_history_substring(shell->history, event + 1);
+        } else {
+            // !prefix recalls the most recent command starting with prefix
+            history_num = search_history_prefix(shell->history, event);
+        }
         char *command = find_line_history(shell->history, history_num);
         if (command == NULL) {
-            printf("!%d: No such command in history\n", history_num);
+            if (isdigit((unsigned char)event[0])) {
+                printf("!%d: No such command in history\n", history_num);
+            } else {
+                printf("!%s: event not found\n", event);
+            }
             return NULL;
         }
         printf("%s\n", command);
@@ -253,29 +1250,20 @@ char *builtin_cmd(char **argv) {
             printf("bg: No job number provided\n");
             return NULL;
         }
-        // Check if the job number is a JOB_ID or PID
-        char* job_arg = argv[1];
-        bool is_job_id = job_arg[0] == '%';
-        int job_num = atoi(is_job_id ? job_arg + 1 : job_arg);
-        pid_t pid;
-        int job_id;
-        if (is_job_id) {
-            // If it's a JOB_ID, find the corresponding job and get its 
-            job_id = job_num;
-            pid = get_job_pid(shell->jobs, shell->max_jobs, job_num);
-        } else {
-            // If it's a PID, find the corresponding job and get its JOB_ID
-            job_id = get_job_jid(shell->jobs, shell->max_jobs, job_num);
-            pid = job_num;
-        }
-        if (pid == -1 || job_id == 0) {
+        // The job number is a JOB_ID (%JOB_ID) or PID
+        pid_t pid = job_arg_pid(argv[1]);
+        if (pid == -1) {
             // If the job number is not valid, print error message
             printf("bg: Invalid job number\n");
             return NULL;
         }
-        // Resume the job
-        change_job_state(shell->jobs, shell->max_jobs, job_id, BACKGROUND);
-        Kill(-pid, SIGCONT);
+        // Resume the job, captured output goes back to the ring
+        change_job_state(shell->jobs, shell->max_jobs, pid, BACKGROUND);
+        job_t *job = find_job(shell->jobs, shell->max_jobs, pid);
+        if (job != NULL && job->capture != NULL) {
+            capture_foreground(job->capture, false);
+        }
+        signal_job(pid, SIGCONT);
         return NULL;
     } else if (strcmp(argv[0], "fg") == 0) {
         // If the command is fg, bring the job to the foreground
@@ -284,45 +1272,176 @@ char *builtin_cmd(char **argv) {
             printf("fg: No job number provided\n");
             return NULL;
         }
-        // Check if the job number is a JOB_ID or PID
-        char* job_arg = argv[1];
-        bool is_job_id = job_arg[0] == '%';
-        int job_num = atoi(is_job_id ? job_arg + 1 : job_arg);
-        pid_t pid;
-        int job_id;
-        if (is_job_id) {
-            // If it's a JOB_ID, find the corresponding job and get its 
-            job_id = job_num;
-            pid = get_job_pid(shell->jobs, shell->max_jobs, job_num);
-        } else {
-            // If it's a PID, find the corresponding job and get its JOB_ID
-            job_id = get_job_jid(shell->jobs, shell->max_jobs, job_num);
-            pid = job_num;
-        }
-        if (pid == -1 || job_id == 0) {
+        // The job number is a JOB_ID (%JOB_ID) or PID
+        pid_t pid = job_arg_pid(argv[1]);
+        if (pid == -1) {
             // If the job number is not valid, print error message
             printf("fg: Invalid job number\n");
             return NULL;
         }
-        // Resume the job
-        change_job_state(shell->jobs, shell->max_jobs, job_id, FOREGROUND);
-        Kill(-pid, SIGCONT);
+        // Resume the job, the output it captured in the background is written first
+        change_job_state(shell->jobs, shell->max_jobs, pid, FOREGROUND);
+        job_t *job = find_job(shell->jobs, shell->max_jobs, pid);
+        if (job != NULL && job->capture != NULL) {
+            capture_foreground(job->capture, true);
+        }
+        fg_pid = pid;
+        signal_job(pid, SIGCONT);
+        // Wait for the job like any other foreground job
+        wait_foreground(pid);
+        return NULL;
+    } else if (strcmp(argv[0], "hash") == 0) {
+        // If the command is hash, manage the remembered locations of commands found in PATH
+        if (argv[1] == NULL) {
+            print_path_cache(shell->path_cache, false);
+        } else if (strcmp(argv[1], "-r") == 0) {
+            path_cache_clear(shell->path_cache);
+        } else if (strcmp(argv[1], "-l") == 0) {
+            print_path_cache(shell->path_cache, true);
+        } else if (strcmp(argv[1], "-p") == 0) {
+            if (argv[2] == NULL || argv[3] == NULL) {
+                printf("hash: usage: hash -p path name\n");
+                return NULL;
+            }
+            path_cache_set(shell->path_cache, argv[3], argv[2]);
+        } else {
+            for (int i = 1; argv[i] != NULL; i++) {
+                if (!path_cache_add(shell->path_cache, argv[i])) {
+                    printf("hash: %s: not found\n", argv[i]);
+                }
+            }
+        }
+        return NULL;
+    } else if (strcmp(argv[0], "parallel") == 0) {
+        // If the command is parallel, run a command once per line of input with a bounded number of jobs in flight
+        parallel_jobs(argv);
+        return NULL;
+    } else if (strcmp(argv[0], "memstats") == 0) {
+        // If the command is memstats, print the allocation counters, or reset them with -r
+        if (argv[1] != NULL && strcmp(argv[1], "-r") == 0) {
+            memset(&alloc_stats, 0, sizeof(alloc_stats));
+            return NULL;
+        }
+        printf("arena: %lu allocations, %lu bytes, %lu chunks, %lu releases\n", alloc_stats.arena_allocs,
+            alloc_stats.arena_bytes, alloc_stats.arena_chunks, alloc_stats.arena_releases);
+        printf("pools: %lu mallocs\n", alloc_stats.pool_mallocs);
+        struct mallinfo2 info = mallinfo2();
+        printf("heap: %zu bytes in use, %zu bytes free\n", info.uordblks, info.fordblks);
+        return NULL;
+    } else if (strcmp(argv[0], "wait") == 0) {
+        // If the command is wait, block until the given jobs terminate, or until one of them terminates with -n
+        if (argv[1] != NULL && strcmp(argv[1], "-n") == 0) {
+            wait_jobs(argv + 2, true);
+        } else {
+            wait_jobs(argv + 1, false);
+        }
+        return NULL;
+    } else if (strcmp(argv[0], "set") == 0) {
+        // If the command is set, turn shell options on (-o NAME) or off (+o NAME), or print them
+        if (argv[1] == NULL) {
+            printf("set %co builtins\n", shell->fast_builtins ? '-' : '+');
+            printf("set %co capture\n", shell->capture ? '-' : '+');
+            printf("set %co notify\n", shell->notify ? '-' : '+');
+            printf("set %co relay\n", shell->relay ? '-' : '+');
+            printf("set %co sched\n", shell->sched ? '-' : '+');
+            if (shell->timeout_ms > 0) {
+                printf("set -o timeout %g\n", shell->timeout_ms / 1000.0);
+            } else {
+                printf("set +o timeout\n");
+            }
+            return NULL;
+        }
+        bool on = argv[1][0] == '-';
+        if (strcmp(argv[1], "-b") == 0 || strcmp(argv[1], "+b") == 0) {
+            // set -b is set -o notify
+            shell->notify = on;
+        } else if ((strcmp(argv[1], "-o") != 0 && strcmp(argv[1], "+o") != 0) || argv[2] == NULL) {
+            printf("set: usage: set [-o|+o option] [-b|+b]\n");
+        } else if (strcmp(argv[2], "notify") == 0) {
+            shell->notify = on;
+        } else if (strcmp(argv[2], "builtins") == 0) {
+            shell->fast_builtins = on;
+        } else if (strcmp(argv[2], "capture") == 0) {
+            shell->capture = on;
+        } else if (strcmp(argv[2], "relay") == 0) {
+            shell->relay = on;
+        } else if (strcmp(argv[2], "sched") == 0) {
+            shell->sched = on;
+            // Jobs held by the scheduler are let go once it is turned off
+            admit_queued_jobs(shell);
+        } else if (strcmp(argv[2], "timeout") == 0) {
+            // set -o timeout DURATION gives every job a deadline, set +o timeout takes it away
+            double seconds = !on ? 0 : argv[3] != NULL ? parse_interval(argv[3]) : -1;
+            if (seconds < 0) {
+                printf("set: usage: set -o timeout DURATION\n");
+            } else {
+                shell->timeout_ms = interval_ms(seconds);
+            }
+        } else {
+            printf("set: %s: invalid option name\n", argv[2]);
+        }
+        return NULL;
+    } else if (strcmp(argv[0], "stats") == 0) {
+        // If the command is stats, print the latency of the phases of the shell, reset them with -r or print JSON with -j
+#ifdef MSH_NO_STATS
+        printf("stats: timing was compiled out (MSH_NO_STATS)\n");
+#else
+        if (argv[1] != NULL && strcmp(argv[1], "-r") == 0) {
+            reset_stats();
+        } else {
+            print_stats(stdout, argv[1] != NULL && strcmp(argv[1], "-j") == 0);
+        }
+#endif
+        return NULL;
+    } else if (strcmp(argv[0], "sched") == 0) {
+        // If the command is sched, set the limits of the scheduler (-c and -m in percent of PSI avg10, -l for the
+        // load average, 0 ignores a reading) or print the queue and the current readings
+        if (argv[1] != NULL) {
+            pressure_limits_t limits = shell->sched_limits;
+            for (int i = 1; argv[i] != NULL; i += 2) {
+                char *end = NULL;
+                double value = argv[i + 1] != NULL ? strtod(argv[i + 1], &end) : -1;
+                double *limit = strcmp(argv[i], "-c") == 0 ? &limits.cpu : strcmp(argv[i], "-m") == 0 ? &limits.memory :
+                    strcmp(argv[i], "-l") == 0 ? &limits.load : NULL;
+                if (limit == NULL || end == argv[i + 1] || end == NULL || *end != '\0' || value < 0) {
+                    printf("sched: usage: sched [-c PERCENT] [-m PERCENT] [-l LOAD]\n");
+                    return NULL;
+                }
+                *limit = value;
+            }
+            shell->sched_limits = limits;
+            admit_queued_jobs(shell);
+            return NULL;
+        }
+        pressure_t pressure;
+        read_pressure(&pressure);
+        printf("sched %s, %d queued jobs\n", shell->sched ? "on" : "off", shell->job_queue->count);
+        print_pressure(stdout, &pressure, &shell->sched_limits);
         return NULL;
     } else if (strcmp(argv[0], "kill") == 0) {
         if (argv[1] == NULL || argv[2] == NULL) {
             printf("kill: Not enough arguments\n");
             return NULL;
         }
-        int pid = atoi(argv[2]);
+        // The process is a PID or a JOB_ID (%JOB_ID), the known jobs are signalled through their pidfds
+        pid_t pid = job_arg_pid(argv[2]);
+        if (pid == -1) {
+            pid = argv[2][0] == '%' ? 0 : atoi(argv[2]);
+        }
+        if (pid <= 0) {
+            // Never signal the process group of the shell itself
+            printf("kill: %s: no such job\n", argv[2]);
+            return NULL;
+        }
         // Send kill signal
         if (strcmp(argv[1], "2") == 0) {
-            kill(-pid, SIGINT);
+            signal_job(pid, SIGINT);
         } else if (strcmp(argv[1], "9") == 0) {
-            kill(-pid, SIGKILL);
+            signal_job(pid, SIGKILL);
         } else if (strcmp(argv[1], "18") == 0) {
-            kill(-pid, SIGCONT);
+            signal_job(pid, SIGCONT);
         } else if (strcmp(argv[1], "19") == 0) {
-            kill(-pid, SIGSTOP);
+            signal_job(pid, SIGSTOP);
         } else {
             printf("error: invalid signal number\n");
             return NULL;
@@ -337,8 +1456,32 @@ char *builtin_cmd(char **argv) {
 void exit_shell(msh_t *shell) {
     // Deallocate history
     free_history(shell->history);
+    // Write what was captured for the background jobs that still run, they lose whatever they write afterwards
+    for (int i = 0; i < shell->max_jobs; i++) {
+        if (shell->jobs[i].capture != NULL) {
+            end_capture(shell->jobs[i].capture);
+            shell->jobs[i].capture = NULL;
+        }
+    }
     // Deallocate jobs
     free_jobs(shell->jobs, shell->max_jobs);
+    // Deallocate the admission queue, jobs still waiting in it are never launched
+    if (shell->job_queue->count > 0) {
+        printf("msh: %d queued jobs were not started\n", shell->job_queue->count);
+    }
+    free_job_queue(shell->job_queue);
+    // Deallocate the command path cache
+    free_path_cache(shell->path_cache);
+    // Deallocate the input buffer
+    if (shell->input != NULL) {
+        free_input(shell->input);
+    }
+    // Deallocate the command line arena
+    free_arena(shell->line_arena);
+    // Let the zygote exit, the jobs it launched keep running
+    if (shell->zygote != NULL) {
+        stop_zygote(shell->zygote);
+    }
     // Deallocate shell memory
     free(shell);
 }
\ No newline at end of file
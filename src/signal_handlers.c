@@ -6,74 +6,264 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <sys/pidfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "event_loop.h"
+#include "fast_builtins.h"
 #include "csapp.h"
 
 volatile sig_atomic_t fg_pid;
+// A signal for a foreground pseudo job (see fast_builtins.h), delivered by the foreground wait
+volatile sig_atomic_t fg_pseudo_signal;
 extern msh_t *shell;
 
+static sigset_t child_mask;
+// Cleared when the kernel cannot open pidfds, children are then reaped from the SIGCHLD signalfd only
+static bool use_pidfds = true;
+
+void job_exited(pid_t pid, const struct rusage *usage)
+{
+    job_t *job = find_job(shell->jobs, shell->max_jobs, pid);
+    if (job != NULL) {
+        add_usage(job, usage);
+    }
+    if (job != NULL && job->stages != NULL) {
+        // A stage of a pipeline terminated, stop watching its pidfd
+        job_stage_t *stage = find_stage(job, pid);
+        if (stage != NULL && stage->pidfd != -1) {
+            event_loop_remove_fd(stage->pidfd);
+            close(stage->pidfd);
+            stage->pidfd = -1;
+        }
+        // The pipeline is done once its last stage terminated
+        if (end_stage(shell->jobs, shell->max_jobs, pid) > 0) {
+            return;
+        }
+        pid = job->pid;
+    }
+    // Case 1: Child process terminated normally or by a signal
+    if (pid == fg_pid) {
+        // If the child process is the foreground process, set fg_pid to 0 so the parent will know
+        fg_pid = 0;
+    }
+    // The output captured for the job is written before the job is reported done
+    if (job != NULL && job->capture != NULL) {
+        end_capture(job->capture);
+        job->capture = NULL;
+    }
+    // The deadline of the job no longer applies, a job that was stopped by it is reported as timed out
+    if (job != NULL && job->timeout_timer != -1) {
+        event_loop_cancel_timer(job->timeout_timer);
+        job->timeout_timer = -1;
+    }
+    // The notification is queued, the shell writes the pending ones together (see notify.h)
+    notify_job(pid, job != NULL && job->timeout_signal != 0 ? JOB_TIMED_OUT : JOB_DONE);
+    if (job != NULL) {
+        finish_usage(job);
+        // Jobs run with the time builtin report what they used
+        if (job->timed) {
+            fflush(stdout);
+            print_usage(stderr, &job->usage);
+        }
+    }
+    // Stop watching the pidfd of the job and delete the job from the job list
+    if (job != NULL && job->pidfd != -1) {
+        event_loop_remove_fd(job->pidfd);
+        close(job->pidfd);
+    }
+    delete_job(shell->jobs, shell->max_jobs, pid);
+}
+
+void job_stopped(pid_t pid)
+{
+    job_t *job = find_job(shell->jobs, shell->max_jobs, pid);
+    if (job != NULL && job->stages != NULL) {
+        // Every stage of a pipeline stops, the job is reported once
+        if (job->stopped) {
+            return;
+        }
+        job->stopped = true;
+        pid = job->pid;
+    }
+    // Case 2: Child process stopped by a signal
+    if (pid == fg_pid) {
+        fg_pid = 0;
+    }
+    // Change the job state to suspended, output it writes once it continues is captured again
+    change_job_state(shell->jobs, shell->max_jobs, pid, SUSPENDED);
+    job = find_job(shell->jobs, shell->max_jobs, pid);
+    if (job != NULL && job->capture != NULL) {
+        capture_foreground(job->capture, false);
+    }
+    notify_job(pid, JOB_STOPPED);
+}
+
+void job_continued(pid_t pid)
+{
+    job_t *job = find_job(shell->jobs, shell->max_jobs, pid);
+    if (job != NULL && job->stages != NULL) {
+        // Every stage of a pipeline continues, the job is reported once
+        if (!job->stopped) {
+            return;
+        }
+        job->stopped = false;
+        pid = job->pid;
+    }
+    // Case 3: Child process continued by a signal, it runs in the foreground only if fg waits for it
+    change_job_state(shell->jobs, shell->max_jobs, pid, pid == fg_pid ? FOREGROUND : BACKGROUND);
+    notify_job(pid, JOB_CONTINUED);
+}
+
 /*
-* sigchld_handler - The kernel sends a SIGCHLD to the shell whenever
-*     a child job terminates (becomes a zombie), or stops because it
-*     received a SIGSTOP or SIGTSTP signal. The handler reaps all
-*     available zombie children, but doesn't wait for any other
-*     currently running children to terminate.
+* reap_children - Reaps all available zombie children, and records the
+*     children that stopped because they received a SIGSTOP or SIGTSTP
+*     signal or continued because they received a SIGCONT signal. It
+*     doesn't wait for any other currently running children to terminate.
+*     Only used when pidfds are not available.
 * Citation: Bryant and O’Hallaron, Computer Systems: A Programmer’s Perspective, Third Edition
 */
-void sigchld_handler(int sig)
-{   
-    // Initialize signal masks and variables
-    int olderrno = errno;
-    sigset_t mask_all, prev_all;
+static void reap_children(void)
+{
     pid_t pid;
     int status;
-    // Block all signals
-    Sigfillset(&mask_all);
-    // Reap all available zombie children
-    while ((pid = waitpid(-1, &status, WNOHANG|WUNTRACED|WCONTINUED)) > 0) { 
+    struct rusage usage;
+    // Reap all available zombie children, wait4 also returns the resources they used
+    while ((pid = wait4(-1, &status, WNOHANG|WUNTRACED|WCONTINUED, &usage)) > 0) { 
         if (WIFEXITED(status) || WIFSIGNALED(status)) {
-            // Case 1: Child process terminated normally or by a signal
-            if (pid == fg_pid) {
-                // If the child process is the foreground process, set fg_pid to 0 so the parent will know
-                fg_pid = 0;
-                Sio_puts("pid "); Sio_putl(pid); Sio_puts(" Done\n");
-                Sio_puts("msh> ");
-            } else {
-                Sio_puts("pid "); Sio_putl(pid); Sio_puts(" Done\n");
-                Sio_puts("msh> ");
-            }
-            // Block and delete the job from the job list
-            Sigprocmask(SIG_BLOCK, &mask_all, &prev_all);
-            delete_job(shell->jobs, shell->max_jobs, pid);
-            Sigprocmask(SIG_SETMASK, &prev_all, NULL);
+            job_exited(pid, &usage);
         } 
-        
         if (WIFSTOPPED(status)) {
-            // Case 2: Child process stopped by a signal
-            if (pid == fg_pid) {
-                fg_pid = 0;
+            job_stopped(pid);
+        }
+        if (WIFCONTINUED(status)) {
+            job_continued(pid);
+        }
+    }
+}
+
+/*
+* pidfd_event - Called by the event loop when the pidfd of a job becomes
+*     readable, i.e. the job terminated. Only that child is reaped, the
+*     other children are not scanned.
+*/
+static void pidfd_event(int fd, void *data)
+{
+    uint64_t start = STATS_START();
+    pid_t pid = (pid_t)(intptr_t)data;
+    int status;
+    struct rusage usage;
+    pid_t reaped = wait4(pid, &status, WNOHANG, &usage);
+    if (reaped == 0) {
+        return;
+    }
+    if (reaped < 0) {
+        // The child was already reaped by reap_children, only forget its pidfd
+        event_loop_remove_fd(fd);
+        close(fd);
+        return;
+    }
+    job_exited(pid, &usage);
+    STATS_RECORD(STAT_REAP, start);
+    // Launch background jobs that were waiting for the slot freed above
+    if (shell->job_queue->count > 0) {
+        admit_queued_jobs(shell);
+    }
+}
+
+/*
+* sigchld_event - Called by the event loop when the signalfd has pending
+*     SIGCHLD signals. Several SIGCHLD may be merged into one, so the
+*     signalfd is drained and the state changes are handled in a single
+*     batch. Terminated children are left to their pidfds.
+*/
+static void sigchld_event(int fd, void *data)
+{
+    uint64_t start = STATS_START();
+    struct signalfd_siginfo info;
+    while (read(fd, &info, sizeof(info)) == sizeof(info)) {
+        // Keep reading until the signalfd is empty
+    }
+    if (!use_pidfds) {
+        reap_children();
+    } else {
+        // Collect the stopped and continued children without reaping the terminated ones
+        siginfo_t child;
+        while (true) {
+            child.si_pid = 0;
+            if (waitid(P_ALL, 0, &child, WSTOPPED|WCONTINUED|WNOHANG) < 0 || child.si_pid == 0) {
+                break;
+            }
+            if (child.si_code == CLD_STOPPED) {
+                job_stopped(child.si_pid);
+            } else if (child.si_code == CLD_CONTINUED) {
+                job_continued(child.si_pid);
             }
-            // Block and change the job state to suspended
-            Sigprocmask(SIG_BLOCK, &mask_all, &prev_all);
-            change_job_state(shell->jobs, shell->max_jobs, pid, SUSPENDED);
-            Sigprocmask(SIG_SETMASK, &prev_all, NULL);
-            Sio_puts("pid "); Sio_putl(pid); Sio_puts(" Stopped\n");
-            Sio_puts("msh> ");
         }
+    }
+    STATS_RECORD(STAT_REAP, start);
+    // Launch background jobs that were waiting for the slots freed above
+    if (shell->job_queue->count > 0) {
+        admit_queued_jobs(shell);
+    }
+}
 
-        if (WIFCONTINUED(status)) {
-            // Case 3: Child process continued by a signal
-            fg_pid = pid;
-            // Block and change the job state to continue running again
-            Sigprocmask(SIG_BLOCK, &mask_all, &prev_all);
-            change_job_state(shell->jobs, shell->max_jobs, pid, FOREGROUND);
-            Sigprocmask(SIG_SETMASK, &prev_all, NULL);
-            Sio_puts("pid "); Sio_putl(pid); Sio_puts(" Continue\n");
-            Sio_puts("msh> ");
+void watch_child(pid_t pid) {
+    if (!use_pidfds || shell->zygote != NULL) {
+        return;
+    }
+    int fd = pidfd_open(pid, 0);
+    if (fd < 0) {
+        // Fall back to reaping every child from the SIGCHLD signalfd
+        use_pidfds = false;
+        return;
+    }
+    // The stages of a pipeline each have their own pidfd
+    job_t *job = find_job(shell->jobs, shell->max_jobs, pid);
+    job_stage_t *stage = find_stage(job, pid);
+    if (stage != NULL) {
+        stage->pidfd = fd;
+    } else {
+        job->pidfd = fd;
+    }
+    event_loop_add_fd(fd, pidfd_event, (void *)(intptr_t)pid);
+}
+
+/*
+* zygote_event - Called by the event loop when the zygote forwarded state
+*     changes of the jobs it launched. The zygote already reaped the
+*     terminated ones.
+*/
+static void zygote_event(int fd, void *data)
+{
+    uint64_t start = STATS_START();
+    zygote_event_t event;
+    ssize_t n;
+    while ((n = recv(fd, &event, sizeof(event), 0)) == sizeof(event)) {
+        if (event.code == CLD_STOPPED) {
+            job_stopped(event.pid);
+        } else if (event.code == CLD_CONTINUED) {
+            job_continued(event.pid);
+        } else {
+            job_exited(event.pid, &event.usage);
         }
     }
-    // Restore errno, prevent unintended side effects
-    errno = olderrno;
+    if (n == 0) {
+        // The zygote exited, nothing more will arrive
+        event_loop_remove_fd(fd);
+    }
+    STATS_RECORD(STAT_REAP, start);
+    // Launch background jobs that were waiting for the slots freed above
+    if (shell->job_queue->count > 0) {
+        admit_queued_jobs(shell);
+    }
+}
 
+void watch_zygote(int event_fd) {
+    event_loop_add_fd(event_fd, zygote_event, NULL);
 }
 
 /*
@@ -90,6 +280,9 @@ void sigint_handler(int sig)
         // Restore the default signal handler for stopping the shell
         Signal(SIGINT, SIG_DFL);
         Kill(-pid, SIGINT);
+    } else if (is_pseudo_job(fg_pid)) {
+        // Pseudo jobs have no process to signal, the shell handles it once the handler returns
+        fg_pseudo_signal = SIGINT;
     } else {
         Kill(-fg_pid, SIGINT);
     }
@@ -108,6 +301,8 @@ void sigtstp_handler(int sig)
     if (fg_pid == 0) {
         Signal(SIGINT, SIG_DFL);
         Kill(-fg_pid, SIGTSTP);
+    } else if (is_pseudo_job(fg_pid)) {
+        fg_pseudo_signal = SIGTSTP;
     } else {
         Kill(-fg_pid, SIGTSTP);
     }
@@ -141,6 +336,19 @@ void initialize_signal_handlers() {
     setup_handler(SIGINT,  sigint_handler);   /* ctrl-c */
     // sigtstp handler: Catches SIGTSTP (ctrl-z) signals.
     setup_handler(SIGTSTP, sigtstp_handler);  /* ctrl-z */
-    // sigchld handler: Catches SIGCHILD signals.
-    setup_handler(SIGCHLD, sigchld_handler);  /* Terminated or stopped child */
+    // SIGCHLD is blocked for good and read from a signalfd by the event loop instead
+    sigset_t mask_one;
+    Sigemptyset(&mask_one);
+    Sigaddset(&mask_one, SIGCHLD);
+    Sigprocmask(SIG_BLOCK, &mask_one, &child_mask);
+    Sigdelset(&child_mask, SIGCHLD);
+    int fd = signalfd(-1, &mask_one, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (fd < 0) {
+        unix_error("signalfd error");
+    }
+    event_loop_add_fd(fd, sigchld_event, NULL);
+}
+
+const sigset_t *child_signal_mask(void) {
+    return &child_mask;
 }
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "stats.h"
+#include <string.h>
+
+histogram_t phase_stats[STAT_PHASES];
+
+static const char *phase_names[STAT_PHASES] = {"evaluate", "parse", "launch", "reap"};
+
+static int bucket_of(uint64_t value) {
+    // Small values are exact, larger ones keep their top HISTOGRAM_SUB_BITS bits below the leading one
+    if (value < HISTOGRAM_SUB_BUCKETS) {
+        return (int)value;
+    }
+    int exponent = 63 - __builtin_clzll(value);
+    int sub = (int)((value >> (exponent - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUB_BUCKETS - 1));
+    return (exponent - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS + sub;
+}
+
+static uint64_t bucket_upper_bound(int bucket) {
+    // The largest value that falls into the bucket
+    if (bucket < HISTOGRAM_SUB_BUCKETS) {
+        return bucket;
+    }
+    int exponent = bucket / HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BITS - 1;
+    uint64_t sub = bucket % HISTOGRAM_SUB_BUCKETS;
+    uint64_t width = (uint64_t)1 << (exponent - HISTOGRAM_SUB_BITS);
+    return ((uint64_t)1 << exponent) + (sub + 1) * width - 1;
+}
+
+void histogram_record(histogram_t *histogram, uint64_t value) {
+    histogram->counts[bucket_of(value)]++;
+    histogram->count++;
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+}
+
+uint64_t histogram_percentile(const histogram_t *histogram, double percentile) {
+    if (histogram->count == 0) {
+        return 0;
+    }
+    // The rank of the value, rounded up so p100 is the last value
+    uint64_t rank = (uint64_t)(percentile / 100 * histogram->count + 0.999999);
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += histogram->counts[i];
+        if (seen >= rank) {
+            uint64_t bound = bucket_upper_bound(i);
+            return bound < histogram->max ? bound : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+void reset_stats(void) {
+    memset(phase_stats, 0, sizeof(phase_stats));
+}
+
+void print_stats(FILE *out, bool json) {
+    for (int i = 0; i < STAT_PHASES; i++) {
+        const histogram_t *histogram = &phase_stats[i];
+        uint64_t p50 = histogram_percentile(histogram, 50);
+        uint64_t p99 = histogram_percentile(histogram, 99);
+        if (json) {
+            fprintf(out, "{\"phase\":\"%s\",\"count\":%lu,\"p50_ns\":%lu,\"p99_ns\":%lu,\"max_ns\":%lu}\n", phase_names[i],
+                histogram->count, p50, p99, histogram->max);
+        } else {
+            fprintf(out, "%-8s %8lu  p50 %10.1fus  p99 %10.1fus  max %10.1fus\n", phase_names[i], histogram->count,
+                p50 / 1000.0, p99 / 1000.0, histogram->max / 1000.0);
+        }
+    }
+}
@@ -0,0 +1,320 @@
+#include "zygote.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+// Sent before the strings of a launch request: the path, the arguments and the environment, each NUL terminated
+// The file descriptors of the child (see launch_process) are passed along with it, in the order of has_fd
+typedef struct zygote_request {
+    int mode;
+    int argc;
+    int envc;
+    size_t bytes;
+    pid_t pgid;
+    bool has_fd[3];
+    bool more_stages;   // More stages of the same pipeline follow, the process group leader must not be reaped yet
+}zygote_request_t;
+
+static bool write_full(int fd, const void *buf, size_t len) {
+    // Helper function to write all of buf, MSG_NOSIGNAL turns a dead zygote into an error instead of SIGPIPE
+    const char *p = buf;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool read_full(int fd, void *buf, size_t len) {
+    // Helper function to read exactly len bytes, fails at end of file
+    char *p = buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+static char **unpack_strings(int count, char **p) {
+    // Helper function to build a NULL terminated array of count strings read from *p
+    char **strings = malloc((count + 1) * sizeof(char *));
+    for (int i = 0; i < count; i++) {
+        strings[i] = *p;
+        *p += strlen(*p) + 1;
+    }
+    strings[count] = NULL;
+    return strings;
+}
+
+static bool read_request(int request_fd, zygote_request_t *request, int *fds) {
+    // Helper function to read the fixed part of a request together with the file descriptors passed with it
+    char control[CMSG_SPACE(3 * sizeof(int))];
+    struct iovec iov = {request, sizeof(*request)};
+    struct msghdr msg = {0};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t n;
+    while ((n = recvmsg(request_fd, &msg, MSG_WAITALL | MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR) {
+        // Retry interrupted reads
+    }
+    if (n != sizeof(*request)) {
+        return false;
+    }
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    int *passed = cmsg != NULL && cmsg->cmsg_type == SCM_RIGHTS ? (int *)CMSG_DATA(cmsg) : NULL;
+    int next = 0;
+    for (int i = 0; i < 3; i++) {
+        fds[i] = request->has_fd[i] && passed != NULL ? passed[next++] : -1;
+    }
+    return true;
+}
+
+static bool serve_request(int request_fd, const sigset_t *child_mask, bool *more_stages) {
+    // Helper function to launch the command of one request and send back its pid, false once the shell is gone
+    zygote_request_t request;
+    int fds[3];
+    if (!read_request(request_fd, &request, fds)) {
+        return false;
+    }
+    *more_stages = request.more_stages;
+    char *buf = malloc(request.bytes);
+    if (!read_full(request_fd, buf, request.bytes)) {
+        free(buf);
+        return false;
+    }
+    char *p = buf;
+    char *path = p;
+    p += strlen(p) + 1;
+    char **argv = unpack_strings(request.argc, &p);
+    char **envp = unpack_strings(request.envc, &p);
+    // The launchers start the child with the environment in environ
+    char **saved_environ = environ;
+    environ = envp;
+    pid_t pid = launch_process(request.mode, path, argv, child_mask, request.pgid, fds);
+    environ = saved_environ;
+    for (int i = 0; i < 3; i++) {
+        if (fds[i] != -1) {
+            close(fds[i]);
+        }
+    }
+    // A launch error was printed, make sure it shows before the shell prints its prompt
+    fflush(stdout);
+    free(argv);
+    free(envp);
+    free(buf);
+    return write_full(request_fd, &pid, sizeof(pid));
+}
+
+static int child_code(int status) {
+    // The si_code waitid would have reported for the wait status
+    if (WIFSTOPPED(status)) {
+        return CLD_STOPPED;
+    } else if (WIFCONTINUED(status)) {
+        return CLD_CONTINUED;
+    } else if (WIFSIGNALED(status)) {
+        return WCOREDUMP(status) ? CLD_DUMPED : CLD_KILLED;
+    }
+    return CLD_EXITED;
+}
+
+static void zygote_main(int request_fd, int event_fd, pid_t shell_pid) {
+    // Die with the shell, even if it is killed before it can close the sockets
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    if (getppid() != shell_pid) {
+        _exit(0);
+    }
+    // ctrl-c and ctrl-z reach the whole process group of the shell, they are meant for the foreground job only.
+    // They are blocked rather than ignored, ignored signals would stay ignored in the children.
+    sigset_t blocked, child_mask;
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGCHLD);
+    sigaddset(&blocked, SIGINT);
+    sigaddset(&blocked, SIGTSTP);
+    sigprocmask(SIG_BLOCK, &blocked, &child_mask);
+    // The shell catches them, so its children start with the default actions even if the shell was started
+    // with them ignored (i.e. in the background of a script)
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTSTP, SIG_DFL);
+    sigset_t chld;
+    sigemptyset(&chld);
+    sigaddset(&chld, SIGCHLD);
+    int signal_fd = signalfd(-1, &chld, SFD_CLOEXEC | SFD_NONBLOCK);
+    // State changes wait here while the shell is not reading them, the zygote never blocks on the event socket
+    zygote_event_t *pending = NULL;
+    int num_pending = 0;
+    int pending_size = 0;
+    bool more_stages = false;
+    while (true) {
+        struct pollfd fds[3] = {
+            {request_fd, POLLIN, 0},
+            {signal_fd, more_stages ? 0 : POLLIN, 0},
+            {event_fd, num_pending > 0 ? POLLOUT : 0, 0},
+        };
+        if (poll(fds, 3, -1) < 0) {
+            continue;
+        }
+        if (fds[0].revents != 0 && !serve_request(request_fd, &child_mask, &more_stages)) {
+            break;
+        }
+        // The stages of a pipeline join the process group of the first one, which must not be reaped in between
+        if (fds[1].revents != 0 && !more_stages) {
+            struct signalfd_siginfo info;
+            while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+                // Keep reading until the signalfd is empty
+            }
+            // Reap the terminated children with the resources they used and collect the stopped and continued ones
+            pid_t pid;
+            int status;
+            struct rusage usage;
+            while ((pid = wait4(-1, &status, WNOHANG|WUNTRACED|WCONTINUED, &usage)) > 0) {
+                if (num_pending == pending_size) {
+                    pending_size = pending_size == 0 ? 16 : 2 * pending_size;
+                    pending = realloc(pending, pending_size * sizeof(zygote_event_t));
+                }
+                pending[num_pending].pid = pid;
+                pending[num_pending].code = child_code(status);
+                pending[num_pending].usage = usage;
+                num_pending++;
+            }
+        }
+        // Forward the state changes in order, as many as the socket takes
+        int sent = 0;
+        while (sent < num_pending && send(event_fd, &pending[sent], sizeof(zygote_event_t), MSG_DONTWAIT | MSG_NOSIGNAL) > 0) {
+            sent++;
+        }
+        memmove(pending, pending + sent, (num_pending - sent) * sizeof(zygote_event_t));
+        num_pending -= sent;
+    }
+    _exit(0);
+}
+
+zygote_t *start_zygote(void) {
+    int request_fds[2], event_fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, request_fds) < 0) {
+        return NULL;
+    }
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, event_fds) < 0) {
+        close(request_fds[0]);
+        close(request_fds[1]);
+        return NULL;
+    }
+    pid_t shell_pid = getpid();
+    // Buffered output would be printed twice
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(request_fds[0]);
+        close(event_fds[0]);
+        zygote_main(request_fds[1], event_fds[1], shell_pid);
+    }
+    close(request_fds[1]);
+    close(event_fds[1]);
+    if (pid < 0) {
+        close(request_fds[0]);
+        close(event_fds[0]);
+        return NULL;
+    }
+    fcntl(event_fds[0], F_SETFL, fcntl(event_fds[0], F_GETFL) | O_NONBLOCK);
+    zygote_t *zygote = malloc(sizeof(zygote_t));
+    zygote->pid = pid;
+    zygote->request_fd = request_fds[0];
+    zygote->event_fd = event_fds[0];
+    return zygote;
+}
+
+static bool send_request(int request_fd, zygote_request_t *request, const int *fds) {
+    // Helper function to send the fixed part of a request together with the file descriptors of the child
+    char control[CMSG_SPACE(3 * sizeof(int))];
+    memset(control, 0, sizeof(control));
+    struct iovec iov = {request, sizeof(*request)};
+    struct msghdr msg = {0};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    int num_fds = 0;
+    int passed[3];
+    for (int i = 0; i < 3; i++) {
+        request->has_fd[i] = fds != NULL && fds[i] != -1;
+        if (request->has_fd[i]) {
+            passed[num_fds++] = fds[i];
+        }
+    }
+    if (num_fds > 0) {
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(num_fds * sizeof(int));
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(num_fds * sizeof(int));
+        memcpy(CMSG_DATA(cmsg), passed, num_fds * sizeof(int));
+    }
+    ssize_t n;
+    while ((n = sendmsg(request_fd, &msg, MSG_NOSIGNAL)) < 0 && errno == EINTR) {
+        // Retry interrupted writes
+    }
+    // The rest of a short write carries no file descriptors
+    return n >= 0 && write_full(request_fd, (char *)request + n, sizeof(*request) - n);
+}
+
+pid_t zygote_launch(zygote_t *zygote, launch_mode_t mode, const char *path, char **argv, pid_t pgid, const int *fds, bool more_stages) {
+    // Pack the path, the arguments and the environment into one buffer
+    zygote_request_t request = {mode, 0, 0, strlen(path) + 1, pgid, {false, false, false}, more_stages};
+    for (; argv[request.argc] != NULL; request.argc++) {
+        request.bytes += strlen(argv[request.argc]) + 1;
+    }
+    for (; environ[request.envc] != NULL; request.envc++) {
+        request.bytes += strlen(environ[request.envc]) + 1;
+    }
+    char *buf = malloc(request.bytes);
+    char *p = stpcpy(buf, path) + 1;
+    for (int i = 0; i < request.argc; i++) {
+        p = stpcpy(p, argv[i]) + 1;
+    }
+    for (int i = 0; i < request.envc; i++) {
+        p = stpcpy(p, environ[i]) + 1;
+    }
+    pid_t pid = -1;
+    bool ok = send_request(zygote->request_fd, &request, fds) && write_full(zygote->request_fd, buf, request.bytes)
+        && read_full(zygote->request_fd, &pid, sizeof(pid));
+    free(buf);
+    if (!ok) {
+        printf("msh: the zygote exited, %s was not started\n", argv[0]);
+        return -1;
+    }
+    return pid;
+}
+
+void stop_zygote(zygote_t *zygote) {
+    // The zygote exits once it reads the end of the request socket
+    close(zygote->request_fd);
+    close(zygote->event_fd);
+    waitpid(zygote->pid, NULL, 0);
+    free(zygote);
+}
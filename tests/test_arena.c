@@ -0,0 +1,81 @@
+#include "arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+static bool failed = false;
+
+void test1() {
+    // Allocations are aligned and do not overlap
+    int test_num = 1; 
+    bool passed = true; 
+    arena_t *arena = alloc_arena(); 
+    char *a = arena_alloc(arena, 3); 
+    long *b = arena_alloc(arena, sizeof(long)); 
+    char *c = arena_strdup(arena, "hello"); 
+    *b = 42; 
+    memcpy(a, "ab", 3); 
+    passed = passed && ((uintptr_t)b % sizeof(long)) == 0 && strcmp(a, "ab") == 0 && *b == 42 && strcmp(c, "hello") == 0; 
+    free_arena(arena); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test2() {
+    // Releasing to a mark reuses the memory without allocating new chunks
+    int test_num = 2; 
+    bool passed = true; 
+    arena_t *arena = alloc_arena(); 
+    arena_mark_t mark = arena_mark(arena); 
+    char *first = arena_alloc(arena, 100); 
+    arena_release(arena, mark); 
+    unsigned long chunks = alloc_stats.arena_chunks; 
+    for (int i = 0; i < 1000; i++) {
+        mark = arena_mark(arena); 
+        char *p = arena_alloc(arena, 100); 
+        passed = passed && p == first; 
+        arena_release(arena, mark); 
+    }
+    passed = passed && alloc_stats.arena_chunks == chunks; 
+    free_arena(arena); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test3() {
+    // Allocations larger than a chunk get a chunk of their own, and chunks are kept after a release
+    int test_num = 3; 
+    bool passed = true; 
+    arena_t *arena = alloc_arena(); 
+    arena_mark_t mark = arena_mark(arena); 
+    char *small = arena_strdup(arena, "small"); 
+    char *big = arena_alloc(arena, 100000); 
+    memset(big, 'x', 100000); 
+    passed = passed && strcmp(small, "small") == 0; 
+    unsigned long chunks = alloc_stats.arena_chunks; 
+    arena_release(arena, mark); 
+    arena_alloc(arena, 10); 
+    arena_alloc(arena, 100000); 
+    passed = passed && alloc_stats.arena_chunks == chunks; 
+    free_arena(arena); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+int main() { 
+    test1(); 
+    test2(); 
+    test3(); 
+    return failed ? 1 : 0; 
+}
@@ -0,0 +1,120 @@
+#include "capture.h"
+#include "event_loop.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+static bool failed = false;
+
+void test1() {
+    // The ring grows up to its limit and then keeps the latest output, the rest is counted as dropped
+    int test_num = 1; 
+    bool passed = true; 
+    int write_fd; 
+    capture_t *capture = start_capture(&write_fd); 
+    passed = passed && capture != NULL && capture->size == 0; 
+    char chunk[4096]; 
+    size_t total = 0; 
+    for (int i = 0; i < 40; i++) {
+        memset(chunk, 'a' + i % 26, sizeof(chunk)); 
+        write(write_fd, chunk, sizeof(chunk)); 
+        total += sizeof(chunk); 
+        capture_read(capture); 
+    }
+    passed = passed && capture->size == CAPTURE_LIMIT && capture->head - capture->tail == CAPTURE_LIMIT; 
+    passed = passed && capture->dropped == total - CAPTURE_LIMIT; 
+    // The view is the last CAPTURE_LIMIT bytes in order, in at most two parts
+    const char *first, *second; 
+    size_t first_len, second_len; 
+    capture_view(capture, &first, &first_len, &second, &second_len); 
+    passed = passed && first_len + second_len == CAPTURE_LIMIT; 
+    passed = passed && first[0] == 'a' + (40 - CAPTURE_LIMIT / 4096) % 26; 
+    const char *last = second_len > 0 ? second + second_len - 1 : first + first_len - 1; 
+    passed = passed && *last == 'a' + 39 % 26; 
+    close(write_fd); 
+    capture_read(capture); 
+    passed = passed && capture->fd == -1; 
+    free(capture->buf); 
+    free(capture); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test2() {
+    // Replayed lines are tagged with the job number, a line cut between two replays is tagged once
+    int test_num = 2; 
+    bool passed = true; 
+    int write_fd; 
+    capture_t *capture = start_capture(&write_fd); 
+    capture->jid = 3; 
+    write(write_fd, "one\ntwo\nthr", 11); 
+    capture_read(capture); 
+    char *buf = NULL; 
+    size_t len = 0; 
+    FILE *out = open_memstream(&buf, &len); 
+    replay_capture(capture, out); 
+    fflush(out); 
+    passed = passed && strcmp(buf, "[3] one\n[3] two\n[3] thr") == 0; 
+    passed = passed && capture->head == capture->tail && !capture->line_start; 
+    write(write_fd, "ee\nfour\n", 8); 
+    capture_read(capture); 
+    replay_capture(capture, out); 
+    fclose(out); 
+    passed = passed && strcmp(buf, "[3] one\n[3] two\n[3] three\n[3] four\n") == 0; 
+    free(buf); 
+    close(write_fd); 
+    capture_read(capture); 
+    free(capture->buf); 
+    free(capture); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test3() {
+    // print_capture writes the ring as it is, across the wrap around
+    int test_num = 3; 
+    bool passed = true; 
+    int write_fd; 
+    capture_t *capture = start_capture(&write_fd); 
+    // Start at the end of a small ring, so the output wraps around to its start
+    capture->buf = malloc(8); 
+    capture->size = 8; 
+    capture->head = 6; 
+    capture->tail = 6; 
+    write(write_fd, "abcdef", 6); 
+    capture_read(capture); 
+    passed = passed && capture->size == 8 && capture->head - capture->tail == 6; 
+    int fds[2]; 
+    pipe(fds); 
+    print_capture(capture, fds[1]); 
+    close(fds[1]); 
+    char buf[64] = {0}; 
+    read(fds[0], buf, sizeof(buf) - 1); 
+    close(fds[0]); 
+    passed = passed && strcmp(buf, "abcdef") == 0; 
+    close(write_fd); 
+    capture_read(capture); 
+    free(capture->buf); 
+    free(capture); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+int main() {
+    event_loop_init(); 
+    test1(); 
+    test2(); 
+    test3(); 
+    return failed ? 1 : 0; 
+}
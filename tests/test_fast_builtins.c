@@ -0,0 +1,155 @@
+#include "fast_builtins.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+static bool failed = false;
+
+static char *capture(char **argv, bool *ran) {
+    // Run a fast builtin with stdout redirected to a temporary file, returns what it printed
+    static char out[256];
+    fflush(stdout);
+    FILE *saved = stdout;
+    stdout = tmpfile();
+    *ran = run_fast_builtin(argv);
+    fflush(stdout);
+    rewind(stdout);
+    size_t n = fread(out, 1, sizeof(out) - 1, stdout);
+    out[n] = '\0';
+    fclose(stdout);
+    stdout = saved;
+    return out;
+}
+void test1() {
+    // echo joins its arguments, -n drops the newline and -e interprets escapes
+    int test_num = 1; 
+    bool passed = true; 
+    bool ran; 
+    char *plain[] = {"echo", "a", "b", NULL}; 
+    passed = passed && strcmp(capture(plain, &ran), "a b\n") == 0 && ran; 
+    char *no_newline[] = {"/bin/echo", "-n", "a", NULL}; 
+    passed = passed && strcmp(capture(no_newline, &ran), "a") == 0 && ran; 
+    char *escapes[] = {"echo", "-e", "a\\tb\\c", "ignored", NULL}; 
+    passed = passed && strcmp(capture(escapes, &ran), "a\tb") == 0 && ran; 
+    char *not_option[] = {"echo", "-x", NULL}; 
+    passed = passed && strcmp(capture(not_option, &ran), "-x\n") == 0 && ran; 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test2() {
+    // printf reuses the format while arguments are left
+    int test_num = 2; 
+    bool passed = true; 
+    bool ran; 
+    char *reuse[] = {"printf", "%s=%d\\n", "a", "1", "b", "2", NULL}; 
+    passed = passed && strcmp(capture(reuse, &ran), "a=1\nb=2\n") == 0 && ran; 
+    char *numbers[] = {"printf", "%5.2f|%x|%c|%%", "3.14159", "255", "xyz", NULL}; 
+    passed = passed && strcmp(capture(numbers, &ran), " 3.14|ff|x|%") == 0 && ran; 
+    char *missing[] = {"printf", "[%s][%d]", NULL}; 
+    passed = passed && strcmp(capture(missing, &ran), "[][0]") == 0 && ran; 
+    // Widths and precisions taken from the arguments are left to the program
+    char *star[] = {"printf", "%s|%*d", "a", "5", "1", NULL}; 
+    passed = passed && strcmp(capture(star, &ran), "") == 0 && !ran; 
+    char *precision[] = {"printf", "%%*d %.*f", "2", "3.14159", NULL}; 
+    passed = passed && strcmp(capture(precision, &ran), "") == 0 && !ran; 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test3() {
+    // Other programs, and utilities outside /bin and /usr/bin, are not run
+    int test_num = 3; 
+    bool passed = true; 
+    bool ran; 
+    char *other[] = {"ls", NULL}; 
+    capture(other, &ran); 
+    passed = passed && !ran; 
+    char *elsewhere[] = {"./echo", "a", NULL}; 
+    capture(elsewhere, &ran); 
+    passed = passed && !ran; 
+    char *in_bin[] = {"/usr/bin/true", NULL}; 
+    capture(in_bin, &ran); 
+    passed = passed && ran; 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test4() {
+    // sleep intervals take units and are added up
+    int test_num = 4; 
+    bool passed = true; 
+    long ms; 
+    char *seconds[] = {"sleep", "1.5", NULL}; 
+    passed = passed && sleep_duration(seconds, &ms) && ms == 1500; 
+    char *units[] = {"/bin/sleep", "1m", "2s", "0.5", NULL}; 
+    passed = passed && sleep_duration(units, &ms) && ms == 62500; 
+    char *hours[] = {"sleep", "1h", NULL}; 
+    passed = passed && sleep_duration(hours, &ms) && ms == 3600000; 
+    char *other[] = {"echo", "1", NULL}; 
+    passed = passed && !sleep_duration(other, &ms); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test5() {
+    // Invalid intervals are rejected
+    int test_num = 5; 
+    bool passed = true; 
+    long ms; 
+    fflush(stdout);
+    FILE *saved = stdout;
+    stdout = tmpfile();
+    char *suffix[] = {"sleep", "1x", NULL}; 
+    passed = passed && sleep_duration(suffix, &ms) && ms == -1; 
+    char *negative[] = {"sleep", "-1", NULL}; 
+    passed = passed && sleep_duration(negative, &ms) && ms == -1; 
+    char *missing[] = {"sleep", NULL}; 
+    passed = passed && sleep_duration(missing, &ms) && ms == -1; 
+    fclose(stdout);
+    stdout = saved;
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test6() {
+    // The intervals of timeout are parsed like those of sleep, in seconds
+    int test_num = 6; 
+    bool passed = true; 
+    passed = passed && parse_interval("30") == 30 && parse_interval("1.5s") == 1.5; 
+    passed = passed && parse_interval("2m") == 120 && parse_interval("1d") == 86400; 
+    passed = passed && parse_interval("0") == 0; 
+    passed = passed && parse_interval("") == -1 && parse_interval("5x") == -1 && parse_interval("-3") == -1; 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+
+int main() {
+    test1(); 
+    test2(); 
+    test3(); 
+    test4(); 
+    test5(); 
+    test6(); 
+    return failed ? 1 : 0;
+}
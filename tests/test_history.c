@@ -4,6 +4,8 @@
 #include <stdlib.h> 
 #include <stdbool.h> 
 
+static bool failed = false;
+
 const char *LINES[] = {"ls -la", "cd ..", "cat file.txt", "sleep 20", "mkdir temp", "echo Hello World", "touch myfile.txt"};  
 
 bool check_find_line(int test_num, history_t *history, const char *expected, int index) {
@@ -14,6 +16,7 @@ bool check_find_line(int test_num, history_t *history, const char *expected, int
         printf("Expected:NULL\n"); 
         printf("Got:%s\n", got); 
         printf("----\n");
+        failed = true; 
         return false; 
     } else if (expected == NULL && got == NULL) {
         return true; 
@@ -23,6 +26,7 @@ bool check_find_line(int test_num, history_t *history, const char *expected, int
         printf("Expected:%s\n",expected); 
         printf("Got:NULL\n"); 
         printf("----\n");
+        failed = true; 
         return false; 
     } else {
         if(strcmp(expected, got) != 0) {
@@ -31,6 +35,7 @@ bool check_find_line(int test_num, history_t *history, const char *expected, int
             printf("Expected:%s\n", expected); 
             printf("Got:%s\n", got); 
             printf("----\n");
+            failed = true; 
             return false; 
         }
     }
@@ -41,7 +46,7 @@ bool check_file(int test_num, const char *expected[], int length) {
     FILE *fp = fopen(HISTORY_FILE_PATH, "r"); 
     if (fp != NULL) {
         char *line = NULL;
-        long int len = 0;
+        size_t len = 0;
         long nRead = getline(&line, &len, fp);
         int i = 0; 
         while (nRead != -1) {
@@ -56,6 +61,7 @@ bool check_file(int test_num, const char *expected[], int length) {
                 printf("----\n");
                 free(line); 
                 fclose(fp); 
+                failed = true; 
                 return false; 
             }
             i++; 
@@ -70,12 +76,14 @@ bool check_file(int test_num, const char *expected[], int length) {
             printf("Expected:%d\n", length); 
             printf("Got:%d\n", i); 
             printf("----\n");
+            failed = true; 
             return false; 
         }
     }else {
         printf("----\n");
         printf("Test %d failed: Could not find history file: ../data/.msh_history\n", test_num);
         printf("----\n");
+        failed = true; 
         return false; 
     }
     return true; 
@@ -175,6 +183,9 @@ void test7() {
     }
     if(passed) {
         printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
     }
 }
 void test8() {
@@ -190,10 +201,10 @@ void test8() {
     //Save the file with the 14 locations 
     free_history(history);   
 
-    //Check only 5 are loaded and at the right locations. 
+    //Check only the last 5 are loaded and at the right locations. 
     history = alloc_history(5); 
     for(int i = 0; i < 5; i++){ 
-        passed = passed && check_find_line(test_num,history,LINES[i],i + 1); 
+        passed = passed && check_find_line(test_num,history,LINES[i + 2],i + 1); 
     }
     //Check that no other locations were added. 
     for(int i = 6; i < 14; i++){
@@ -202,6 +213,9 @@ void test8() {
     } 
     if(passed) {
         printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
     }
 }
 void test9() {
@@ -217,6 +231,9 @@ void test9() {
     }
     if(passed) {
         printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
     }
 }
 void test10() {
@@ -237,6 +254,107 @@ void test10() {
     passed = passed && check_find_line(test_num,history,LINES[3],1); 
     if(passed) {
         printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test11() {
+    int test_num = 11; 
+    bool passed = true; 
+    remove(HISTORY_FILE_PATH);
+    history_t *history = alloc_history(3); 
+    //Add many long entries so the ring wraps around and the storage is compacted several times 
+    char line[600]; 
+    for(int i = 0; i < 1000; i++){
+        int len = snprintf(line, sizeof(line), "echo %d ", i); 
+        memset(line + len, 'a' + i % 26, (i * 7) % 500); 
+        line[len + (i * 7) % 500] = '\0'; 
+        add_line_history(history,line);
+    }
+    //Check only the last 3 entries are kept, oldest first 
+    for(int i = 997; i < 1000; i++){
+        int len = snprintf(line, sizeof(line), "echo %d ", i); 
+        memset(line + len, 'a' + i % 26, (i * 7) % 500); 
+        line[len + (i * 7) % 500] = '\0'; 
+        passed = passed && check_find_line(test_num,history,line,i - 996); 
+    }
+    passed = passed && check_find_line(test_num,history,NULL,4); 
+    free_history(history);   
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test12() {
+    int test_num = 12; 
+    bool passed = true; 
+    remove(HISTORY_FILE_PATH);
+    history_t *history = alloc_history(5); 
+    for(int i = 0; i < 7; i++){
+        add_line_history(history,LINES[i]);
+    }
+    //Only LINES[2] to LINES[6] are in the history, at indexes 1 to 5 
+    passed = passed && search_history_prefix(history, "cat") == 1; 
+    passed = passed && search_history_prefix(history, "ls") == 0; 
+    passed = passed && search_history_substring(history, "file") == 5; 
+    passed = passed && search_history_substring(history, "Hello") == 4; 
+    passed = passed && search_history_substring(history, "la") == 0; 
+    passed = passed && search_history_substring(history, "e") == 5; 
+    //Lines added after the first search are found as well 
+    add_line_history(history,LINES[0]); 
+    passed = passed && search_history_prefix(history, "ls") == 5; 
+    passed = passed && search_history_prefix(history, "cat") == 0; 
+    passed = passed && search_history_substring(history, "-la") == 5; 
+    for(int i = 0; i < 20; i++){
+        add_line_history(history,LINES[i % 7]);
+    }
+    //The history now holds LINES[1] to LINES[5] 
+    passed = passed && search_history_prefix(history, "sleep") == 3; 
+    passed = passed && search_history_substring(history, "temp") == 4; 
+    passed = passed && search_history_substring(history, "myfile") == 0; 
+    if(!passed) {
+        printf("Test %d failed: search_history_prefix or search_history_substring returned an incorrect index.\n", test_num); 
+    }
+    free_history(history);   
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test13() {
+    int test_num = 13; 
+    bool passed = true; 
+    //A shell that was killed leaves more lines in the file than the history holds 
+    FILE *fp = fopen(HISTORY_FILE_PATH, "w"); 
+    for(int i = 0; i < 15; i++){
+        fprintf(fp, "%s\n", LINES[i % 7]); 
+    }
+    fclose(fp); 
+    history_t *history = alloc_history(10); 
+    //The newest 10 lines are loaded and the file keeps only them 
+    for(int i = 5; i < 15; i++){
+        passed = passed && check_find_line(test_num,history,LINES[i % 7],i - 4); 
+    }
+    passed = passed && check_find_line(test_num,history,NULL,11); 
+    const char *expected[10]; 
+    for(int i = 5; i < 15; i++){
+        expected[i - 5] = LINES[i % 7]; 
+    }
+    passed = passed && check_file(test_num, expected, 10); 
+    //Lines added afterwards replace the oldest loaded ones 
+    add_line_history(history,"newest"); 
+    passed = passed && check_find_line(test_num,history,LINES[6],1) && check_find_line(test_num,history,"newest",10); 
+    free_history(history);   
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
     }
 }
 int main() { 
@@ -250,5 +368,8 @@ int main() {
     test8(); 
     test9(); 
     test10(); 
-    return 0; 
+    test11(); 
+    test12(); 
+    test13(); 
+    return failed ? 1 : 0; 
 }
\ No newline at end of file
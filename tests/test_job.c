@@ -0,0 +1,269 @@
+#include "job.h"
+#include <string.h>
+#include <stdio.h> 
+#include <stdlib.h> 
+#include <stdbool.h>
+
+static bool failed = false;
+
+bool check_job(int test_num, job_t *jobs, int max_jobs, pid_t pid, int expected_jid) {
+    int got = get_job_jid(jobs, max_jobs, pid);
+    if (got != expected_jid) {
+        printf("\tTest %d failed: get_job_jid(jobs,%d) returned incorrect value.\n", test_num, pid);
+        printf("Expected:%d\n", expected_jid); 
+        printf("Got:%d\n", got); 
+        failed = true; 
+        return false; 
+    }
+    if (expected_jid != -1 && get_job_pid(jobs, max_jobs, expected_jid) != pid) {
+        printf("\tTest %d failed: get_job_pid(jobs,%d) returned incorrect value.\n", test_num, expected_jid);
+        printf("Expected:%d\n", pid); 
+        printf("Got:%d\n", get_job_pid(jobs, max_jobs, expected_jid)); 
+        failed = true; 
+        return false; 
+    }
+    return true; 
+}
+void test1() {
+    // Jobs get consecutive job ids and can be found by pid
+    int test_num = 1; 
+    bool passed = true; 
+    job_t *jobs = alloc_jobs(4); 
+    passed = passed && add_job(jobs, 4, 100, FOREGROUND, "ls"); 
+    passed = passed && add_job(jobs, 4, 200, BACKGROUND, "sleep 5"); 
+    passed = passed && check_job(test_num, jobs, 4, 100, 1); 
+    passed = passed && check_job(test_num, jobs, 4, 200, 2); 
+    passed = passed && check_job(test_num, jobs, 4, 300, -1); 
+    passed = passed && get_job_pid(jobs, 4, 3) == -1; 
+    free_jobs(jobs, 4); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test2() {
+    // The table refuses jobs once every slot is used and reuses deleted slots
+    int test_num = 2; 
+    bool passed = true; 
+    job_t *jobs = alloc_jobs(2); 
+    passed = passed && add_job(jobs, 2, 100, BACKGROUND, "a"); 
+    passed = passed && add_job(jobs, 2, 200, BACKGROUND, "b"); 
+    passed = passed && !add_job(jobs, 2, 300, BACKGROUND, "c"); 
+    passed = passed && delete_job(jobs, 2, 100); 
+    passed = passed && !delete_job(jobs, 2, 100); 
+    passed = passed && check_job(test_num, jobs, 2, 100, -1); 
+    passed = passed && add_job(jobs, 2, 300, BACKGROUND, "c"); 
+    passed = passed && check_job(test_num, jobs, 2, 300, 1); 
+    passed = passed && check_job(test_num, jobs, 2, 200, 2); 
+    free_jobs(jobs, 2); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test3() {
+    // Changing the state finds the job by pid
+    int test_num = 3; 
+    bool passed = true; 
+    job_t *jobs = alloc_jobs(4); 
+    add_job(jobs, 4, 100, FOREGROUND, "ls"); 
+    passed = passed && change_job_state(jobs, 4, 100, SUSPENDED); 
+    passed = passed && !change_job_state(jobs, 4, 101, SUSPENDED); 
+    passed = passed && jobs[0].state == SUSPENDED; 
+    free_jobs(jobs, 4); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test4() {
+    // Many colliding inserts and deletes keep every remaining job reachable
+    int test_num = 4; 
+    bool passed = true; 
+    int max_jobs = 4096; 
+    job_t *jobs = alloc_jobs(max_jobs); 
+    for(int i = 0; i < max_jobs; i++){
+        passed = passed && add_job(jobs, max_jobs, 1000 + i * 64, BACKGROUND, "sleep"); 
+    }
+    for(int i = 0; i < max_jobs; i += 2){
+        passed = passed && delete_job(jobs, max_jobs, 1000 + i * 64); 
+    }
+    for(int i = 0; i < max_jobs; i++){
+        passed = passed && check_job(test_num, jobs, max_jobs, 1000 + i * 64, i % 2 == 0 ? -1 : i + 1); 
+    }
+    free_jobs(jobs, max_jobs); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test5() {
+    // Growing the table keeps existing jobs and makes room for new ones
+    int test_num = 5; 
+    bool passed = true; 
+    job_t *jobs = alloc_jobs(2); 
+    add_job(jobs, 2, 100, BACKGROUND, "a"); 
+    add_job(jobs, 2, 200, BACKGROUND, "b"); 
+    passed = passed && jobs_full(jobs, 2); 
+    jobs = grow_jobs(jobs, 4); 
+    passed = passed && !jobs_full(jobs, 4); 
+    passed = passed && add_job(jobs, 4, 300, BACKGROUND, "c"); 
+    passed = passed && add_job(jobs, 4, 400, BACKGROUND, "d"); 
+    passed = passed && jobs_full(jobs, 4); 
+    for(int i = 1; i <= 4; i++){
+        passed = passed && check_job(test_num, jobs, 4, i * 100, i); 
+    }
+    passed = passed && strcmp(jobs[0].cmd_line, "a") == 0; 
+    free_jobs(jobs, 4); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test6() {
+    // Queued jobs come out in the order they were queued with their own copy of argv
+    int test_num = 6; 
+    bool passed = true; 
+    job_queue_t *queue = alloc_job_queue(); 
+    char first[] = "sleep 1"; 
+    char *argv1[] = {first, first + 6, NULL}; 
+    first[5] = '\0'; 
+    enqueue_job(queue, "/usr/bin/sleep", argv1, "sleep 1"); 
+    char *argv2[] = {"ls", NULL}; 
+    enqueue_job(queue, "/usr/bin/ls", argv2, "ls"); 
+    strcpy(first, "changed"); 
+    passed = passed && queue->count == 2; 
+    queued_job_t *job = dequeue_job(queue); 
+    passed = passed && job != NULL && strcmp(job->argv[0], "sleep") == 0 && strcmp(job->argv[1], "1") == 0 && job->argv[2] == NULL; 
+    passed = passed && strcmp(job->path, "/usr/bin/sleep") == 0; 
+    free_queued_job(job); 
+    job = dequeue_job(queue); 
+    passed = passed && job != NULL && strcmp(job->cmd_line, "ls") == 0; 
+    free_queued_job(job); 
+    passed = passed && dequeue_job(queue) == NULL && queue->count == 0; 
+    free_job_queue(queue); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test7() {
+    // find_job returns the job of a pid until it is deleted, new jobs are not tracked by a pidfd
+    int test_num = 7; 
+    bool passed = true; 
+    job_t *jobs = alloc_jobs(4); 
+    add_job(jobs, 4, 100, BACKGROUND, "sleep 1"); 
+    add_job(jobs, 4, 200, FOREGROUND, "ls"); 
+    job_t *job = find_job(jobs, 4, 200); 
+    passed = passed && job != NULL && job->jid == 2 && job->state == FOREGROUND && job->pidfd == -1; 
+    job->pidfd = 7; 
+    passed = passed && find_job(jobs, 4, 200)->pidfd == 7 && find_job(jobs, 4, 100)->pidfd == -1; 
+    delete_job(jobs, 4, 200); 
+    passed = passed && find_job(jobs, 4, 200) == NULL && find_job(jobs, 4, 300) == NULL; 
+    add_job(jobs, 4, 300, BACKGROUND, "ls"); 
+    passed = passed && find_job(jobs, 4, 300)->pidfd == -1; 
+    free_jobs(jobs, 4); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test8() {
+    // The stages of a pipeline find their job, which is done once every stage ended
+    int test_num = 8; 
+    bool passed = true; 
+    job_t *jobs = alloc_jobs(2); 
+    add_job(jobs, 2, 100, BACKGROUND, "yes | head"); 
+    passed = passed && add_stage(jobs, 2, 100, 101) && add_stage(jobs, 2, 100, 102) && !add_stage(jobs, 2, 999, 103); 
+    job_t *job = find_job(jobs, 2, 102); 
+    passed = passed && job != NULL && job->pid == 100 && job->num_stages == 3 && job->live_stages == 3; 
+    passed = passed && find_stage(job, 101) == &job->stages[1] && find_stage(job, 100) == &job->stages[0] && find_stage(job, 999) == NULL; 
+    // The process group leader keeps finding the job after it ended
+    passed = passed && end_stage(jobs, 2, 100) == 2 && find_job(jobs, 2, 100) == job; 
+    passed = passed && end_stage(jobs, 2, 101) == 1 && find_job(jobs, 2, 101) == NULL && end_stage(jobs, 2, 100) == 1; 
+    passed = passed && end_stage(jobs, 2, 102) == 0; 
+    delete_job(jobs, 2, 100); 
+    passed = passed && find_job(jobs, 2, 100) == NULL && find_job(jobs, 2, 102) == NULL; 
+    // Many stages outgrow the pid index of a small jobs array
+    add_job(jobs, 2, 200, FOREGROUND, "cat"); 
+    for (int i = 1; i <= 40; i++) {
+        add_stage(jobs, 2, 200, 200 + i); 
+    }
+    for (int i = 0; i <= 40; i++) {
+        passed = passed && find_job(jobs, 2, 200 + i) != NULL && find_job(jobs, 2, 200 + i)->pid == 200; 
+    }
+    add_job(jobs, 2, 300, BACKGROUND, "ls"); 
+    passed = passed && find_job(jobs, 2, 300)->stages == NULL && end_stage(jobs, 2, 300) == 0; 
+    delete_job(jobs, 2, 200); 
+    passed = passed && find_job(jobs, 2, 220) == NULL && find_job(jobs, 2, 300) != NULL; 
+    free_jobs(jobs, 2); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test9() {
+    // The usage of the stages of a job adds up, except the memory of the largest one
+    int test_num = 9; 
+    bool passed = true; 
+    job_t *jobs = alloc_jobs(2); 
+    add_job(jobs, 2, 100, FOREGROUND, "yes | head"); 
+    job_t *job = find_job(jobs, 2, 100); 
+    passed = passed && !job->timed && job->usage.wall_ms == 0 && job->usage.user_ms == 0; 
+    struct rusage first = {0}, second = {0}; 
+    first.ru_utime.tv_sec = 1; 
+    first.ru_stime.tv_usec = 500000; 
+    first.ru_maxrss = 2000; 
+    first.ru_nvcsw = 3; 
+    second.ru_utime.tv_usec = 250000; 
+    second.ru_maxrss = 1000; 
+    second.ru_nvcsw = 4; 
+    second.ru_nivcsw = 5; 
+    add_usage(job, &first); 
+    add_usage(job, &second); 
+    add_usage(job, NULL); 
+    passed = passed && job->usage.user_ms == 1250 && job->usage.sys_ms == 500 && job->usage.max_rss_kb == 2000; 
+    passed = passed && job->usage.voluntary_switches == 7 && job->usage.involuntary_switches == 5; 
+    finish_usage(job); 
+    passed = passed && job->usage.wall_ms > 0; 
+    // A new job in the slot starts from nothing
+    delete_job(jobs, 2, 100); 
+    add_job(jobs, 2, 200, BACKGROUND, "ls"); 
+    job = find_job(jobs, 2, 200); 
+    passed = passed && job->usage.user_ms == 0 && job->usage.max_rss_kb == 0 && job->usage.started.tv_sec > 0; 
+    free_jobs(jobs, 2); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+int main() { 
+    test1(); 
+    test2(); 
+    test3(); 
+    test4(); 
+    test5(); 
+    test6(); 
+    test7(); 
+    test8(); 
+    test9(); 
+    return failed ? 1 : 0; 
+}
@@ -0,0 +1,170 @@
+#include "shell.h"
+#include <string.h>
+#include <stdio.h> 
+
+static bool failed = false;
+
+void verify_lex_command(char *line, const char *expected[], int *job_types, int expected_len, bool indexed) {
+    // expected holds the arguments of each non-empty command joined by a single space
+    static int test_num = 0; 
+    int commands_count = 0;  
+    char line_cpy[strlen(line)+1]; 
+    strcpy(line_cpy,line); 
+    arena_t *arena = alloc_arena(); 
+    line_index_t *index = index_line(arena, line_cpy, strlen(line_cpy)); 
+    int max_args = count_args(line); 
+    if(count_args_indexed(index) != max_args) {
+        printf("\tTest %d failed: count_args_indexed(%s) does not match count_args.\n",test_num,line);
+        failed = true; 
+        return; 
+    }
+    char *argv[max_args + 1]; 
+    char *cursor = line_cpy; 
+    int job_type; 
+    while(cursor != NULL) {
+        int argc = indexed ? lex_command_indexed(index, &cursor, argv, &job_type) : lex_command(&cursor, argv, &job_type); 
+        if(argc > max_args || argv[argc] != NULL) {
+            printf("\tTest %d failed: lex_command(%s) wrote past the pre-counted argv.\n",test_num,line);
+            failed = true; 
+            return; 
+        }
+        if(argc == 0) {
+            continue; 
+        }
+        commands_count++; 
+        if(commands_count > expected_len) {
+            break; 
+        }
+        char got[strlen(line)+1]; 
+        got[0] = '\0'; 
+        for(int i = 0; i < argc; i++) {
+            if(i > 0) {
+                strcat(got, " "); 
+            }
+            strcat(got, argv[i]); 
+        }
+        if(strcmp(got,expected[commands_count-1]) != 0) {
+            printf("\tTest %d failed: lex_command(%s) for Job#%d\n",test_num,line,commands_count-1);
+            printf("Expected:%s\n",expected[commands_count-1]); 
+            printf("Got:%s\n", got); 
+            failed = true; 
+            return; 
+        }
+        if(job_type != job_types[commands_count-1]){
+            printf("\tTest %d failed: lex_command(%s) invalid job_type for Job#%d\n",test_num,line,commands_count-1);
+            printf("Expected:%d\n", job_types[commands_count-1]); 
+            printf("Got:%d\n", job_type); 
+            failed = true; 
+            return; 
+        }
+    }
+    if(commands_count != expected_len) {
+        printf("\tTest %d failed: lex_command(%s) did not find the correct number of jobs on the line.\n", test_num,line);
+        printf("Expected:%d\n", expected_len); 
+        printf("Got:%d\n", commands_count); 
+        failed = true; 
+        return; 
+    } 
+    free_arena(arena); 
+    printf("Test %d passed.\n", test_num); 
+    test_num++; 
+}
+int main() { 
+
+    verify_lex_command("ls -la & cd .. ; cat file.txt",(const char *[]){"ls -la","cd ..","cat file.txt"},(int []){0,1,1}, 3,false);
+    verify_lex_command("",NULL,NULL,0,false);
+    verify_lex_command("ls&",(const char *[]){"ls"},(int []){0},1,false);
+    verify_lex_command("ls",(const char *[]){"ls"},(int []){1},1,false);
+    verify_lex_command("    ls;     ",(const char *[]){"ls"},(int []){1},1,false);
+    verify_lex_command("    ls& ",(const char *[]){"ls"},(int []){0},1,false);
+    verify_lex_command("cat file.txt     ;   ls    & cd ..      ;",(const char *[]){"cat file.txt","ls","cd .."},(int []){1,0,1},3,false);
+    verify_lex_command("echo hello&ls&cd ..&",(const char *[]){"echo hello","ls","cd .."},(int []){0,0,0},3,false);
+    verify_lex_command(" ; & ;echo\thello;;",(const char *[]){"echo hello"},(int []){1},1,false);
+    verify_lex_command("   echo bob sally   joe   tim  ben heather          sam     jane   larry              ",(const char *[]){"echo bob sally joe tim ben heather sam jane larry"},(int []){1},1,false);
+
+    verify_lex_command("ls -la & cd .. ; cat file.txt",(const char *[]){"ls -la","cd ..","cat file.txt"},(int []){0,1,1}, 3,true);
+    verify_lex_command("",NULL,NULL,0,true);
+    verify_lex_command("ls&",(const char *[]){"ls"},(int []){0},1,true);
+    verify_lex_command("ls",(const char *[]){"ls"},(int []){1},1,true);
+    verify_lex_command("    ls;     ",(const char *[]){"ls"},(int []){1},1,true);
+    verify_lex_command("    ls& ",(const char *[]){"ls"},(int []){0},1,true);
+    verify_lex_command("cat file.txt     ;   ls    & cd ..      ;",(const char *[]){"cat file.txt","ls","cd .."},(int []){1,0,1},3,true);
+    verify_lex_command("echo hello&ls&cd ..&",(const char *[]){"echo hello","ls","cd .."},(int []){0,0,0},3,true);
+    verify_lex_command(" ; & ;echo\thello;;",(const char *[]){"echo hello"},(int []){1},1,true);
+    verify_lex_command("   echo bob sally   joe   tim  ben heather          sam     jane   larry              ",(const char *[]){"echo bob sally joe tim ben heather sam jane larry"},(int []){1},1,true);
+
+    // The '&' of the pipe operator |& does not end the command
+    verify_lex_command("ls |& wc; a|&b & c",(const char *[]){"ls |& wc","a|&b","c"},(int []){1,0,1},3,false);
+    verify_lex_command("ls |& wc; a|&b & c",(const char *[]){"ls |& wc","a|&b","c"},(int []){1,0,1},3,true);
+
+    // A long line crosses several words of the bitmask index
+    char long_line[1000]; 
+    strcpy(long_line, "  "); 
+    for(int i = 0; i < 60; i++) {
+        strcat(long_line, i % 20 == 19 ? "arg;" : "arg\t "); 
+    }
+    const char *expected[3]; 
+    char command[300] = "arg"; 
+    for(int i = 1; i < 20; i++) {
+        strcat(command, " arg"); 
+    }
+    expected[0] = expected[1] = expected[2] = command; 
+    verify_lex_command(long_line,expected,(int []){1,1,1},3,false); 
+    verify_lex_command(long_line,expected,(int []){1,1,1},3,true); 
+
+    // Every classifier the processor supports builds the same index as the scalar one
+    char chars[300]; 
+    for(int i = 0; i < 299; i++) {
+        chars[i] = (char)(i * 37 % 255 + 1); 
+    }
+    chars[299] = '\0'; 
+    uint64_t spaces[5], separators[5], expected_spaces[5], expected_separators[5]; 
+    classify_set_backend("scalar"); 
+    classify_line(chars, 299, expected_spaces, expected_separators); 
+    const char *backends[] = {"sse2", "avx2"}; 
+    for(int i = 0; i < 2; i++) {
+        if(classify_set_backend(backends[i])) {
+            classify_line(chars, 299, spaces, separators); 
+            if(memcmp(spaces, expected_spaces, sizeof(spaces)) != 0 || memcmp(separators, expected_separators, sizeof(separators)) != 0) {
+                printf("\tTest %s failed: classify_line does not match the scalar classifier.\n", backends[i]); 
+                failed = true; 
+            } else {
+                printf("Test %s passed.\n", backends[i]); 
+            }
+        }
+    }
+
+    // The stages of a pipeline are split at | and |&, with or without whitespace around them
+    arena_t *arena = alloc_arena(); 
+    char pipeline[] = "cat -n file|grep x |& wc -l|sort"; 
+    char *argv[16]; 
+    char *cursor = pipeline; 
+    int job_type; 
+    lex_command(&cursor, argv, &job_type); 
+    char ***stages; 
+    bool *merge_stderr; 
+    int num_stages = split_pipeline(arena, argv, &stages, &merge_stderr); 
+    bool split = num_stages == 4 && strcmp(stages[0][0], "cat") == 0 && strcmp(stages[0][2], "file") == 0 && stages[0][3] == NULL
+        && strcmp(stages[1][0], "grep") == 0 && stages[1][2] == NULL && strcmp(stages[2][1], "-l") == 0 && stages[2][2] == NULL
+        && strcmp(stages[3][0], "sort") == 0 && stages[3][1] == NULL
+        && !merge_stderr[0] && merge_stderr[1] && !merge_stderr[2] && !merge_stderr[3]; 
+    char *single[] = {"ls", "-l", NULL}; 
+    split = split && split_pipeline(arena, single, &stages, &merge_stderr) == 1; 
+    char empty_stage[] = "ls | | wc"; 
+    cursor = empty_stage; 
+    lex_command(&cursor, argv, &job_type); 
+    split = split && split_pipeline(arena, argv, &stages, &merge_stderr) == -1; 
+    char no_command[] = "ls |"; 
+    cursor = no_command; 
+    lex_command(&cursor, argv, &job_type); 
+    split = split && split_pipeline(arena, argv, &stages, &merge_stderr) == -1; 
+    free_arena(arena); 
+    if(!split) {
+        printf("\tTest pipeline failed: split_pipeline did not split the stages.\n"); 
+        failed = true; 
+    } else {
+        printf("Test pipeline passed.\n"); 
+    }
+    
+    return failed ? 1 : 0; 
+}
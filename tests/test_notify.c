@@ -0,0 +1,90 @@
+#include "notify.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+static bool failed = false;
+
+static char *capture(bool direct, const char *prompt) {
+    // Flush the notifications into a pipe standing in for stdout, returns what was written
+    static char buf[65536];
+    int fds[2];
+    pipe(fds);
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    dup2(fds[1], STDOUT_FILENO);
+    flush_notifications(direct, prompt);
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    close(fds[1]);
+    ssize_t len = 0, n;
+    while ((n = read(fds[0], buf + len, sizeof(buf) - 1 - len)) > 0) {
+        len += n;
+    }
+    close(fds[0]);
+    buf[len] = '\0';
+    return buf;
+}
+void test1() {
+    // Queued notifications are written in order, followed by the prompt
+    int test_num = 1; 
+    bool passed = true; 
+    passed = passed && !notifications_pending(); 
+    notify_job(100, JOB_DONE); 
+    notify_job(200, JOB_STOPPED); 
+    notify_job(200, JOB_CONTINUED); 
+    passed = passed && notifications_pending(); 
+    passed = passed && strcmp(capture(true, "msh> "), "pid 100 Done\npid 200 Stopped\npid 200 Continue\nmsh> ") == 0; 
+    passed = passed && !notifications_pending(); 
+    // The prompt is written on its own when nothing is queued
+    passed = passed && strcmp(capture(false, "msh> "), "msh> ") == 0 && strcmp(capture(true, NULL), "") == 0; 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test2() {
+    // A full ring moves its notifications to stdout first, nothing is lost or reordered
+    int test_num = 2; 
+    bool passed = true; 
+    int count = NOTIFY_RING_SIZE + 5; 
+    fflush(stdout); 
+    int saved = dup(STDOUT_FILENO); 
+    int fds[2]; 
+    pipe(fds); 
+    dup2(fds[1], STDOUT_FILENO); 
+    for (int i = 0; i < count; i++) {
+        notify_job(1000 + i, JOB_DONE); 
+    }
+    flush_notifications(false, NULL); 
+    fflush(stdout); 
+    dup2(saved, STDOUT_FILENO); 
+    close(saved); 
+    close(fds[1]); 
+    FILE *out = fdopen(fds[0], "r"); 
+    char line[64], expected[64]; 
+    int lines = 0; 
+    while (fgets(line, sizeof(line), out) != NULL) {
+        sprintf(expected, "pid %d Done\n", 1000 + lines); 
+        passed = passed && strcmp(line, expected) == 0; 
+        lines++; 
+    }
+    fclose(out); 
+    passed = passed && lines == count; 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+int main() { 
+    test1(); 
+    test2(); 
+    return failed ? 1 : 0; 
+}
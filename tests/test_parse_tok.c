@@ -2,6 +2,8 @@
 #include <string.h>
 #include <stdio.h> 
 
+static bool failed = false;
+
 void verify_parse_tok(char *line, const char *expected[], int *job_types, int expected_len) {
     static int test_num = 0; 
     int commands_count = 0;  
@@ -16,12 +18,14 @@ void verify_parse_tok(char *line, const char *expected[], int *job_types, int ex
             printf("\tTest %d failed: parse_tok(%s) for Job#%d\n",test_num,line,commands_count-1);
             printf("Expected:%s\n",expected[commands_count-1]); 
             printf("Got:%s\n", (got == NULL) ? "NULL" : got); 
+            failed = true; 
             return; 
         }
         if(job_type != job_types[commands_count-1]){
             printf("\tTest %d failed: parse_tok(%s) invalid job_type for Job#%d\n",test_num,line,commands_count-1);
             printf("Expected:%d\n", job_types[commands_count-1]); 
             printf("Got:%d\n", job_type); 
+            failed = true; 
             return; 
         }
         got = parse_tok(NULL, &job_type);
@@ -30,6 +34,7 @@ void verify_parse_tok(char *line, const char *expected[], int *job_types, int ex
         printf("\tTest %d failed: parse_tok(%s) did not find the correct number of jobs on the line.\n", test_num,line);
         printf("Expected:%d\n", expected_len); 
         printf("Got:%d\n", commands_count); 
+        failed = true; 
         return; 
     } 
     printf("Test %d passed.\n", test_num); 
@@ -51,5 +56,5 @@ int main() {
     verify_parse_tok("echo hello&ls&cd ..&",(const char *[]){"echo hello","ls","cd .."},(int []){0,0,0},3);  
     verify_parse_tok("echo hello;               ls",(const char *[]){"echo hello","               ls"},(int []){1,1},2);  
     
-    return 0; 
+    return failed ? 1 : 0; 
 }
\ No newline at end of file
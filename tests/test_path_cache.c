@@ -0,0 +1,152 @@
+#include "path_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static bool failed = false;
+
+static char first_dir[] = "/tmp/msh_path_a_XXXXXX";
+static char second_dir[] = "/tmp/msh_path_b_XXXXXX";
+static char path[256];
+
+static void make_command(const char *dir, const char *name) {
+    // Create an empty executable file named name in dir
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    close(open(path, O_WRONLY | O_CREAT | O_TRUNC, 0755));
+}
+static void remove_command(const char *dir, const char *name) {
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    unlink(path);
+}
+static bool resolves_to(path_cache_t *cache, const char *name, const char *dir) {
+    // Check that name is found in dir, or not found at all if dir is NULL
+    const char *got = path_cache_lookup(cache, name);
+    if (dir == NULL) {
+        return got == NULL;
+    }
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    return got != NULL && strcmp(got, path) == 0;
+}
+static path_entry_t *find_entry(path_cache_t *cache, const char *name) {
+    for (int i = 0; i < cache->num_buckets; i++) {
+        for (path_entry_t *entry = cache->buckets[i]; entry != NULL; entry = entry->next) {
+            if (strcmp(entry->name, name) == 0) {
+                return entry;
+            }
+        }
+    }
+    return NULL;
+}
+void test1() {
+    // A command is searched once and then found in the cache, a missing command is not remembered
+    int test_num = 1; 
+    bool passed = true; 
+    make_command(second_dir, "hit"); 
+    path_cache_t *cache = alloc_path_cache(); 
+    passed = passed && resolves_to(cache, "hit", second_dir) && resolves_to(cache, "hit", second_dir); 
+    path_entry_t *entry = find_entry(cache, "hit"); 
+    passed = passed && entry != NULL && entry->hits == 2 && entry->dir_index == 1; 
+    passed = passed && resolves_to(cache, "miss", NULL) && find_entry(cache, "miss") == NULL && cache->count == 1; 
+    // Names with a slash are not looked up
+    passed = passed && strcmp(path_cache_lookup(cache, "./hit"), "./hit") == 0 && cache->count == 1; 
+    free_path_cache(cache); 
+    remove_command(second_dir, "hit"); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test2() {
+    // A command added to an earlier PATH directory takes over, one removed is searched again
+    int test_num = 2; 
+    bool passed = true; 
+    make_command(second_dir, "tool"); 
+    path_cache_t *cache = alloc_path_cache(); 
+    passed = passed && resolves_to(cache, "tool", second_dir); 
+    make_command(first_dir, "tool"); 
+    passed = passed && resolves_to(cache, "tool", first_dir); 
+    remove_command(first_dir, "tool"); 
+    passed = passed && resolves_to(cache, "tool", second_dir); 
+    remove_command(second_dir, "tool"); 
+    passed = passed && resolves_to(cache, "tool", NULL) && cache->count == 0; 
+    // Changes to a later directory keep the entry
+    make_command(first_dir, "early"); 
+    passed = passed && resolves_to(cache, "early", first_dir); 
+    make_command(second_dir, "other"); 
+    passed = passed && resolves_to(cache, "early", first_dir) && find_entry(cache, "early")->hits == 2; 
+    free_path_cache(cache); 
+    remove_command(first_dir, "early"); 
+    remove_command(second_dir, "other"); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test3() {
+    // hash -p entries are kept until hash -r, which forgets every entry
+    int test_num = 3; 
+    bool passed = true; 
+    make_command(second_dir, "cmd"); 
+    path_cache_t *cache = alloc_path_cache(); 
+    path_cache_set(cache, "alias", "/bin/true"); 
+    passed = passed && path_cache_add(cache, "cmd") && !path_cache_add(cache, "missing") && cache->count == 2; 
+    make_command(first_dir, "other"); 
+    passed = passed && strcmp(path_cache_lookup(cache, "alias"), "/bin/true") == 0; 
+    path_cache_clear(cache); 
+    passed = passed && cache->count == 0 && find_entry(cache, "cmd") == NULL; 
+    passed = passed && resolves_to(cache, "alias", NULL) && resolves_to(cache, "cmd", second_dir); 
+    free_path_cache(cache); 
+    remove_command(second_dir, "cmd"); 
+    remove_command(first_dir, "other"); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test4() {
+    // Changing PATH forgets the entries resolved against the old value
+    int test_num = 4; 
+    bool passed = true; 
+    make_command(first_dir, "both"); 
+    make_command(second_dir, "both"); 
+    path_cache_t *cache = alloc_path_cache(); 
+    path_cache_set(cache, "alias", "/bin/true"); 
+    passed = passed && resolves_to(cache, "both", first_dir); 
+    char reversed[128]; 
+    snprintf(reversed, sizeof(reversed), "%s:%s", second_dir, first_dir); 
+    setenv("PATH", reversed, 1); 
+    passed = passed && resolves_to(cache, "both", second_dir) && find_entry(cache, "alias") == NULL && cache->count == 1; 
+    free_path_cache(cache); 
+    remove_command(first_dir, "both"); 
+    remove_command(second_dir, "both"); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+
+int main() {
+    mkdtemp(first_dir); 
+    mkdtemp(second_dir); 
+    char path_env[128]; 
+    snprintf(path_env, sizeof(path_env), "%s:%s", first_dir, second_dir); 
+    setenv("PATH", path_env, 1); 
+    test1(); 
+    test2(); 
+    test3(); 
+    test4(); 
+    rmdir(first_dir); 
+    rmdir(second_dir); 
+    return failed ? 1 : 0; 
+}
@@ -0,0 +1,67 @@
+#include "pressure.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+static bool failed = false;
+
+void test1() {
+    // The 10 second average of the some line is read, the full line is ignored
+    int test_num = 1; 
+    bool passed = true; 
+    passed = passed && parse_psi("some avg10=12.50 avg60=3.00 avg300=1.00 total=999\nfull avg10=40.00 avg60=0.00 avg300=0.00 total=0\n") == 12.5; 
+    passed = passed && parse_psi("some avg10=0.00 avg60=0.00 avg300=0.00 total=0\n") == 0; 
+    passed = passed && parse_psi("full avg10=40.00 avg60=0.00 avg300=0.00 total=0\n") == -1; 
+    passed = passed && parse_psi("") == -1; 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test2() {
+    // Any reading above its limit overloads the host, unknown readings and limits of 0 never do
+    int test_num = 2; 
+    bool passed = true; 
+    pressure_limits_t limits = {50, 10, 4}; 
+    passed = passed && !over_limits(&(pressure_t){10, 0, 1}, &limits); 
+    passed = passed && over_limits(&(pressure_t){60, 0, 1}, &limits); 
+    passed = passed && over_limits(&(pressure_t){10, 20, 1}, &limits); 
+    passed = passed && over_limits(&(pressure_t){10, 0, 8}, &limits); 
+    passed = passed && !over_limits(&(pressure_t){-1, -1, -1}, &limits); 
+    limits.load = 0; 
+    passed = passed && !over_limits(&(pressure_t){10, 0, 8}, &limits); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test3() {
+    // The readings of this host are percentages and a load average, or -1 where the kernel has no such file
+    int test_num = 3; 
+    bool passed = true; 
+    pressure_t pressure; 
+    read_pressure(&pressure); 
+    passed = passed && (pressure.cpu == -1 || (pressure.cpu >= 0 && pressure.cpu <= 100)); 
+    passed = passed && (pressure.memory == -1 || (pressure.memory >= 0 && pressure.memory <= 100)); 
+    passed = passed && (pressure.load == -1 || pressure.load >= 0); 
+    // Reading again reuses the open files
+    read_pressure(&pressure); 
+    passed = passed && (pressure.load == -1 || pressure.load >= 0); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+int main() {
+    test1(); 
+    test2(); 
+    test3(); 
+    return failed ? 1 : 0; 
+}
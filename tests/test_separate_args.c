@@ -4,6 +4,8 @@
 #include <stdlib.h> 
 #include <stdbool.h>
 
+static bool failed = false;
+
 void verify_separate_args(char *line, const char *expected_argv[], int expected_argc) {
     static int test_num = 0; 
     int got_argc=-100; 
@@ -13,6 +15,7 @@ void verify_separate_args(char *line, const char *expected_argv[], int expected_
             char **got_argv = separate_args("",&got_argc,&buit_in);
             if (got_argv != NULL) {
                 printf("\tTest %d failed: separate_args(\"\") the function should return NULL.\n",test_num);
+                failed = true; 
                 return; 
             }
     }else {
@@ -23,6 +26,7 @@ void verify_separate_args(char *line, const char *expected_argv[], int expected_
                 printf("\tTest %d failed: separate_args(%s) the argc returned is incorrect.\n",test_num,line);
                 printf("Expected:%d\n",expected_argc); 
                 printf("Got:%d\n", got_argc); 
+                failed = true; 
                 return; 
         }
 
@@ -31,12 +35,14 @@ void verify_separate_args(char *line, const char *expected_argv[], int expected_
                 printf("\tTest %d failed: separate_args(%s), argv[%d] do not match.\n",test_num,line,i);
                 printf("Expected:%s\n",expected_argv[i]); 
                 printf("Got:%s\n", got_argv[i]); 
+                failed = true; 
                 return; 
             }
 
         }
         if(got_argv[expected_argc] != NULL) {
                 printf("\tTest %d failed: separate_args(%s), the argv[argc] must be NULL.\n",test_num,line);
+                failed = true; 
                 return; 
         }
         free(got_argv);
@@ -55,5 +61,5 @@ int main() {
     verify_separate_args("   ls -la      ~/mpcs51082-aut23",(const char *[]){"ls","-la","~/mpcs51082-aut23"},3);  
     verify_separate_args("   ls -la      ~/mpcs51082-aut23      ",(const char *[]){"ls","-la","~/mpcs51082-aut23"},3);  
     verify_separate_args("   echo bob sally   joe   tim  ben heather          sam     jane   larry              ",(const char *[]){"echo","bob","sally","joe","tim","ben","heather","sam","jane","larry"},10); 
-    return 0; 
+    return failed ? 1 : 0; 
 }
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+static bool failed = false;
+
+static char *run_msh(char *const argv[], bool *exited) {
+    // Run ../bin/msh with argv and no stdin, returns what it printed and sets exited if it exited with 0.
+    // A shell that hangs is killed after 10 seconds
+    static char out[4096];
+    int fds[2];
+    pipe(fds);
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        close(STDIN_FILENO);
+        alarm(10);
+        execv("../bin/msh", argv);
+        _exit(127);
+    }
+    close(fds[1]);
+    size_t len = 0;
+    ssize_t n;
+    while (len < sizeof(out) - 1 && (n = read(fds[0], out + len, sizeof(out) - 1 - len)) > 0) {
+        len += n;
+    }
+    out[len] = '\0';
+    close(fds[0]);
+    int status;
+    waitpid(pid, &status, 0);
+    *exited = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    return out;
+}
+void test1() {
+    // wait can be given the same job many more times than the job table has slots
+    int test_num = 1; 
+    bool passed = true; 
+    bool exited; 
+    char commands[512] = "sleep 0.1 &\nwait"; 
+    for (int i = 0; i < 40; i++) {
+        strcat(commands, " %1"); 
+    }
+    strcat(commands, "\necho done"); 
+    char *argv[] = {"msh", "-j", "2", "-c", commands, NULL}; 
+    char *out = run_msh(argv, &exited); 
+    passed = passed && exited && strstr(out, "done\n") != NULL; 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test2() {
+    // With set -o builtins, echo and printf in the background are jobs, in the foreground they run in the shell
+    int test_num = 2; 
+    bool passed = true; 
+    bool exited; 
+    char *argv[] = {"msh", "-c", "set -o builtins\necho bg &\nwait\necho fg\nprintf %s%*d\\n x 3 1", NULL}; 
+    char *out = run_msh(argv, &exited); 
+    passed = passed && exited && strstr(out, "Running \t echo\n") != NULL && strstr(out, "bg\n") != NULL; 
+    passed = passed && strstr(out, "Running \t echo fg") == NULL && strstr(out, "fg\n") != NULL; 
+    // printf with * widths is launched as the program
+    passed = passed && strstr(out, "x  1\n") != NULL; 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test3() {
+    // parallel waits for the other jobs to free their slots, and gives up if only stopped jobs hold them
+    int test_num = 3; 
+    bool passed = true; 
+    bool exited; 
+    FILE *args = fopen("parallel_args", "w"); 
+    fputs("a\nb\n", args); 
+    fclose(args); 
+    char *argv[] = {"msh", "-j", "1", "-c", "sleep 0.2 &\nparallel -j 2 -a parallel_args echo\necho after", NULL}; 
+    char *out = run_msh(argv, &exited); 
+    passed = passed && exited && strstr(out, "a\n") != NULL && strstr(out, "parallel: 2 jobs") != NULL && strstr(out, "after\n") != NULL; 
+    char *stopped[] = {"msh", "-j", "1", "-c", "sleep 5 &\nkill 19 %1\nparallel -j 2 -a parallel_args echo\nkill 9 %1", NULL}; 
+    out = run_msh(stopped, &exited); 
+    passed = passed && exited && strstr(out, "parallel: reached the maximum jobs limit\n") != NULL; 
+    remove("parallel_args"); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test4() {
+    // fg continues every process of a job whose process group was stopped, not only the first one
+    int test_num = 4; 
+    bool passed = true; 
+    bool exited; 
+    FILE *script = fopen("stop_group.sh", "w"); 
+    fputs("sleep 0.2 &\nkill -STOP 0\nwait\necho finished\n", script); 
+    fclose(script); 
+    char *argv[] = {"msh", "-c", "/bin/sh stop_group.sh &\n/bin/sleep 0.1\nfg %1\necho after", NULL}; 
+    char *out = run_msh(argv, &exited); 
+    passed = passed && exited && strstr(out, "finished\n") != NULL && strstr(out, "after\n") != NULL; 
+    remove("stop_group.sh"); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test5() {
+    // A pipeline that cannot get its pipes is not started at all, the shell goes on with the next command
+    int test_num = 5; 
+    bool passed = true; 
+    bool exited; 
+    char commands[512] = "echo hi"; 
+    for (int i = 0; i < 40; i++) {
+        strcat(commands, " | cat"); 
+    }
+    strcat(commands, "\necho after"); 
+    char *argv[] = {"msh", "-c", commands, NULL}; 
+    // The shell inherits a limit too low for the 80 pipe ends
+    struct rlimit saved, limit; 
+    getrlimit(RLIMIT_NOFILE, &saved); 
+    limit = saved; 
+    limit.rlim_cur = 48; 
+    setrlimit(RLIMIT_NOFILE, &limit); 
+    char *out = run_msh(argv, &exited); 
+    setrlimit(RLIMIT_NOFILE, &saved); 
+    passed = passed && exited && strstr(out, "hi\n") == NULL && strstr(out, "after\n") != NULL; 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+
+int main() {
+    test1(); 
+    test2(); 
+    test3(); 
+    test4(); 
+    test5(); 
+    return failed ? 1 : 0; 
+}
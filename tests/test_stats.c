@@ -0,0 +1,89 @@
+#include "stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+static bool failed = false;
+
+void test1() {
+    // Small values are exact and percentiles pick the recorded values in order
+    int test_num = 1; 
+    bool passed = true; 
+    histogram_t *histogram = calloc(1, sizeof(histogram_t)); 
+    passed = passed && histogram_percentile(histogram, 50) == 0; 
+    for (uint64_t v = 1; v <= 10; v++) {
+        histogram_record(histogram, v); 
+    }
+    passed = passed && histogram->count == 10 && histogram->max == 10; 
+    passed = passed && histogram_percentile(histogram, 50) == 5 && histogram_percentile(histogram, 99) == 10; 
+    passed = passed && histogram_percentile(histogram, 0) == 1 && histogram_percentile(histogram, 100) == 10; 
+    free(histogram); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test2() {
+    // Large values land in buckets at most 1/16th wider than the value, the maximum is exact
+    int test_num = 2; 
+    bool passed = true; 
+    histogram_t *histogram = calloc(1, sizeof(histogram_t)); 
+    uint64_t values[] = {17, 1000, 123456, 987654321, UINT64_MAX / 3}; 
+    for (int i = 0; i < 5; i++) {
+        memset(histogram, 0, sizeof(histogram_t)); 
+        histogram_record(histogram, values[i]); 
+        histogram_record(histogram, values[i] * 2); 
+        uint64_t p50 = histogram_percentile(histogram, 50); 
+        passed = passed && p50 >= values[i] && p50 - values[i] <= values[i] / 16; 
+        passed = passed && histogram_percentile(histogram, 100) == values[i] * 2; 
+    }
+    // A long tail shows up in p99 only
+    memset(histogram, 0, sizeof(histogram_t)); 
+    for (int i = 0; i < 990; i++) {
+        histogram_record(histogram, 1000); 
+    }
+    for (int i = 0; i < 10; i++) {
+        histogram_record(histogram, 1000000); 
+    }
+    passed = passed && histogram_percentile(histogram, 50) < 1100 && histogram_percentile(histogram, 99) < 1100; 
+    passed = passed && histogram_percentile(histogram, 99.5) >= 1000000 && histogram->max == 1000000; 
+    free(histogram); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test3() {
+    // The phases are reset together and printed as one JSON object each
+    int test_num = 3; 
+    bool passed = true; 
+    histogram_record(&phase_stats[STAT_PARSE], 500); 
+    char *buf = NULL; 
+    size_t len = 0; 
+    FILE *out = open_memstream(&buf, &len); 
+    print_stats(out, true); 
+    fclose(out); 
+    passed = passed && strstr(buf, "{\"phase\":\"parse\",\"count\":1,\"p50_ns\":500,\"p99_ns\":500,\"max_ns\":500}\n") != NULL; 
+    passed = passed && strstr(buf, "\"phase\":\"reap\"") != NULL; 
+    free(buf); 
+    reset_stats(); 
+    passed = passed && phase_stats[STAT_PARSE].count == 0 && histogram_percentile(&phase_stats[STAT_PARSE], 50) == 0; 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+int main() {
+    test1(); 
+    test2(); 
+    test3(); 
+    return failed ? 1 : 0; 
+}
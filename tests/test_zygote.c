@@ -0,0 +1,112 @@
+#include "zygote.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+static bool failed = false;
+
+static bool next_event(zygote_t *zygote, zygote_event_t *event) {
+    // Wait up to a second for the next state change forwarded by the zygote
+    struct pollfd fd = {zygote->event_fd, POLLIN, 0};
+    return poll(&fd, 1, 1000) == 1 && recv(zygote->event_fd, event, sizeof(*event), 0) == sizeof(*event);
+}
+void test1() {
+    // A command launched by the zygote runs in its own process group and its exit is forwarded
+    int test_num = 1; 
+    bool passed = true; 
+    zygote_t *zygote = start_zygote(); 
+    passed = passed && zygote != NULL; 
+    char *argv[] = {"sh", "-c", "exit 3", NULL}; 
+    pid_t pid = zygote_launch(zygote, LAUNCH_SPAWN, "/bin/sh", argv, 0, NULL, false); 
+    zygote_event_t event; 
+    passed = passed && pid > 0 && next_event(zygote, &event) && event.pid == pid && event.code == CLD_EXITED; 
+    stop_zygote(zygote); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test2() {
+    // Stops and continues are forwarded in order, and both launcher backends work
+    int test_num = 2; 
+    bool passed = true; 
+    zygote_t *zygote = start_zygote(); 
+    char *argv[] = {"sleep", "5", NULL}; 
+    pid_t pid = zygote_launch(zygote, LAUNCH_FORK, "/bin/sleep", argv, 0, NULL, false); 
+    zygote_event_t event; 
+    passed = passed && pid > 0 && getpgid(pid) == pid; 
+    kill(pid, SIGSTOP); 
+    passed = passed && next_event(zygote, &event) && event.pid == pid && event.code == CLD_STOPPED; 
+    kill(pid, SIGCONT); 
+    passed = passed && next_event(zygote, &event) && event.pid == pid && event.code == CLD_CONTINUED; 
+    kill(pid, SIGKILL); 
+    passed = passed && next_event(zygote, &event) && event.pid == pid && event.code == CLD_KILLED; 
+    stop_zygote(zygote); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+void test3() {
+    // A program that does not exist is not started
+    int test_num = 3; 
+    bool passed = true; 
+    zygote_t *zygote = start_zygote(); 
+    char *argv[] = {"nosuch", NULL}; 
+    fflush(stdout); 
+    passed = passed && zygote_launch(zygote, LAUNCH_SPAWN, "/nonexistent/nosuch", argv, 0, NULL, false) == -1; 
+    stop_zygote(zygote); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+
+void test4() {
+    // The file descriptors of a stage are passed to the zygote, and a later stage joins the process group of the first
+    int test_num = 4; 
+    bool passed = true; 
+    zygote_t *zygote = start_zygote(); 
+    int pipe_fds[2]; 
+    pipe(pipe_fds); 
+    char *first[] = {"sleep", "1", NULL}; 
+    pid_t leader = zygote_launch(zygote, LAUNCH_SPAWN, "/bin/sleep", first, 0, NULL, true); 
+    char *second[] = {"echo", "hi", NULL}; 
+    int fds[3] = {-1, pipe_fds[1], -1}; 
+    pid_t pid = zygote_launch(zygote, LAUNCH_FORK, "/bin/echo", second, leader, fds, false); 
+    close(pipe_fds[1]); 
+    char buf[16] = {0}; 
+    passed = passed && leader > 0 && pid > 0 && read(pipe_fds[0], buf, sizeof(buf) - 1) == 3 && strcmp(buf, "hi\n") == 0; 
+    zygote_event_t event; 
+    passed = passed && next_event(zygote, &event) && event.pid == pid && getpgid(leader) == leader; 
+    kill(leader, SIGKILL); 
+    passed = passed && next_event(zygote, &event) && event.pid == leader; 
+    close(pipe_fds[0]); 
+    stop_zygote(zygote); 
+    if(passed) {
+        printf("Test %d Passed\n", test_num); 
+    } else {
+        printf("Test %d Failed\n", test_num); 
+        failed = true; 
+    }
+}
+
+int main() {
+    test1(); 
+    test2(); 
+    test3(); 
+    test4(); 
+    return failed ? 1 : 0;
+}